@@ -0,0 +1,207 @@
+#pragma once
+
+// Heap profiling, compiled in only when configured with -DAOC_ALLOC_PROFILE=ON. It replaces the global operator
+// new/delete with counting versions, so it must be included by exactly one translation unit per program - which for
+// these single-file days means main.cpp.
+//
+//   AOC_ALLOC_PHASE(name)  attribute every allocation from here on, on any thread, to the named phase
+//
+// For each phase the report gives allocation and free counts, bytes requested, the peak number of live bytes seen
+// while it was current and a log2 histogram of request sizes. It's written as JSON when the process exits, to the
+// file named by $AOC_ALLOC_PROFILE_OUT or to stderr.
+
+#if AOC_ALLOC_PROFILE
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+class AllocProfile {
+    static constexpr size_t maxPhases = 16;
+    // Every block carries its size just in front of it so that unsized deletes can be accounted for. The header
+    // is padded to keep the block itself at malloc's alignment.
+    static constexpr size_t header = alignof(std::max_align_t);
+
+    struct Phase {
+        std::atomic<const char*> name = nullptr;
+        std::atomic<uint64_t> allocations = 0;
+        std::atomic<uint64_t> frees = 0;
+        std::atomic<uint64_t> bytes = 0;
+        std::atomic<uint64_t> peakLive = 0;
+        std::array<std::atomic<uint64_t>, 65> sizes{};
+    };
+
+    // Constant-initialised, so allocations made before main or after the report still land somewhere.
+    static std::array<Phase, maxPhases> phases;
+    static std::atomic<size_t> current;
+    static std::atomic<uint64_t> live;
+
+    [[nodiscard]] static size_t HeaderFor(std::align_val_t align) noexcept {
+        return std::max(header, static_cast<size_t>(align));
+    }
+
+    static void Record(size_t bytes) noexcept {
+        auto& phase = phases[current.load(std::memory_order_relaxed)];
+        phase.allocations.fetch_add(1, std::memory_order_relaxed);
+        phase.bytes.fetch_add(bytes, std::memory_order_relaxed);
+        phase.sizes[std::bit_width(bytes)].fetch_add(1, std::memory_order_relaxed);
+        const auto now = live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        for (auto seen = phase.peakLive.load(std::memory_order_relaxed);
+             seen < now && !phase.peakLive.compare_exchange_weak(seen, now, std::memory_order_relaxed););
+    }
+
+    // Written with stdio rather than iostreams so that reporting doesn't itself allocate through the hook.
+    static void Report() noexcept {
+        current = maxPhases - 1;
+        const auto* path = std::getenv("AOC_ALLOC_PROFILE_OUT");
+        auto* out = path ? std::fopen(path, "w") : stderr;
+        if (!out)
+            return;
+        std::fputs("{\n  \"phases\": [", out);
+        auto first = true;
+        for (size_t i = 0; i + 1 < maxPhases; ++i) {
+            auto& phase = phases[i];
+            if (i == 0 ? phase.allocations == 0 && phase.frees == 0 : phase.name.load() == nullptr)
+                continue;
+            std::fprintf(out, "%s\n    {\"name\": \"%s\", \"allocations\": %llu, \"frees\": %llu, \"bytes\": %llu, "
+                         "\"peak_live_bytes\": %llu, \"log2_sizes\": [", first ? "" : ",",
+                         phase.name.load() ? phase.name.load() : "startup",
+                         static_cast<unsigned long long>(phase.allocations.load()),
+                         static_cast<unsigned long long>(phase.frees.load()),
+                         static_cast<unsigned long long>(phase.bytes.load()),
+                         static_cast<unsigned long long>(phase.peakLive.load()));
+            auto last = phase.sizes.size();
+            while (last > 1 && phase.sizes[last - 1] == 0)
+                --last;
+            for (size_t s = 0; s < last; ++s)
+                std::fprintf(out, "%s%llu", s ? ", " : "", static_cast<unsigned long long>(phase.sizes[s].load()));
+            std::fputs("]}", out);
+            first = false;
+        }
+        std::fputs(first ? "]\n}\n" : "\n  ]\n}\n", out);
+        if (path)
+            std::fclose(out);
+    }
+
+    struct Reporter {
+        ~Reporter() {
+            Report();
+        }
+    };
+    static Reporter reporter;
+public:
+    // Phase names must outlive the process, which string literals do. Reusing a name resumes that phase.
+    static void SetPhase(const char* name) noexcept {
+        for (size_t i = 1; i + 1 < maxPhases; ++i) {
+            const char* expected = nullptr;
+            if (phases[i].name.compare_exchange_strong(expected, name) || std::strcmp(expected, name) == 0) {
+                current = i;
+                return;
+            }
+        }
+    }
+
+    [[nodiscard]] static void* Allocate(size_t bytes, std::align_val_t align = std::align_val_t{header}) {
+        const auto offset = HeaderFor(align);
+        auto* block = static_cast<std::byte*>(align == std::align_val_t{header} ? std::malloc(bytes + offset) :
+            std::aligned_alloc(offset, (bytes + offset + offset - 1) / offset * offset));
+        if (!block)
+            return nullptr;
+        std::memcpy(block + offset - sizeof(size_t), &bytes, sizeof(size_t));
+        Record(bytes);
+        return block + offset;
+    }
+
+    static void Free(void* ptr, std::align_val_t align = std::align_val_t{header}) noexcept {
+        if (!ptr)
+            return;
+        auto* block = static_cast<std::byte*>(ptr) - HeaderFor(align);
+        size_t bytes;
+        std::memcpy(&bytes, block + HeaderFor(align) - sizeof(size_t), sizeof(size_t));
+        live.fetch_sub(bytes, std::memory_order_relaxed);
+        phases[current.load(std::memory_order_relaxed)].frees.fetch_add(1, std::memory_order_relaxed);
+        std::free(block);
+    }
+
+    [[nodiscard]] static void* AllocateOrThrow(size_t bytes, std::align_val_t align = std::align_val_t{header}) {
+        if (auto* ptr = Allocate(bytes, align))
+            return ptr;
+        throw std::bad_alloc{};
+    }
+};
+
+constinit inline std::array<AllocProfile::Phase, AllocProfile::maxPhases> AllocProfile::phases{};
+constinit inline std::atomic<size_t> AllocProfile::current = 0;
+constinit inline std::atomic<uint64_t> AllocProfile::live = 0;
+inline AllocProfile::Reporter AllocProfile::reporter;
+
+void* operator new(size_t bytes) {
+    return AllocProfile::AllocateOrThrow(bytes);
+}
+
+void* operator new[](size_t bytes) {
+    return AllocProfile::AllocateOrThrow(bytes);
+}
+
+void* operator new(size_t bytes, std::align_val_t align) {
+    return AllocProfile::AllocateOrThrow(bytes, align);
+}
+
+void* operator new[](size_t bytes, std::align_val_t align) {
+    return AllocProfile::AllocateOrThrow(bytes, align);
+}
+
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept {
+    return AllocProfile::Allocate(bytes);
+}
+
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept {
+    return AllocProfile::Allocate(bytes);
+}
+
+void operator delete(void* ptr) noexcept {
+    AllocProfile::Free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+    AllocProfile::Free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    AllocProfile::Free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+    AllocProfile::Free(ptr);
+}
+
+void operator delete(void* ptr, std::align_val_t align) noexcept {
+    AllocProfile::Free(ptr, align);
+}
+
+void operator delete[](void* ptr, std::align_val_t align) noexcept {
+    AllocProfile::Free(ptr, align);
+}
+
+void operator delete(void* ptr, size_t, std::align_val_t align) noexcept {
+    AllocProfile::Free(ptr, align);
+}
+
+void operator delete[](void* ptr, size_t, std::align_val_t align) noexcept {
+    AllocProfile::Free(ptr, align);
+}
+
+#define AOC_ALLOC_PHASE(name) AllocProfile::SetPhase(name)
+
+#else
+
+#define AOC_ALLOC_PHASE(name) ((void)0)
+
+#endif
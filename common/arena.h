@@ -0,0 +1,37 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <istream>
+#include <memory_resource>
+#include <string_view>
+
+// Bytes left in a seekable stream, or 0 if it can't tell (e.g. a pipe).
+[[nodiscard]] inline size_t RemainingBytes(std::istream& in) {
+    const auto pos = in.tellg();
+    if (pos == std::istream::pos_type(-1) || !in.seekg(0, std::ios_base::end)) {
+        in.clear();
+        return 0;
+    }
+    const auto end = in.tellg();
+    in.seekg(pos);
+    return end > pos ? static_cast<size_t>(end - pos) : 0;
+}
+
+// Monotonic arena for node-heavy containers that are built while parsing and afterwards only read. The first block
+// is sized from the input so that a typical run goes to the heap once; nothing is freed individually, and the whole
+// arena is released together when its owner goes away.
+class ParseArena : public std::pmr::monotonic_buffer_resource {
+    static constexpr size_t minimumBlock = 1024;
+public:
+    ParseArena(std::istream& in, size_t bytesPerInputByte) : ParseArena{RemainingBytes(in) * bytesPerInputByte} {}
+
+    explicit ParseArena(size_t expectedBytes) : monotonic_buffer_resource{std::max(expectedBytes, minimumBlock)} {}
+
+    // A copy of text which lives as long as the arena.
+    [[nodiscard]] std::string_view Intern(std::string_view text) {
+        auto* data = static_cast<char*>(allocate(text.size(), alignof(char)));
+        std::ranges::copy(text, data);
+        return {data, text.size()};
+    }
+};
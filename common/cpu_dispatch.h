@@ -0,0 +1,119 @@
+#pragma once
+
+// Runtime choice between builds of a kernel for different instruction sets, so a binary built for the baseline ISA
+// still uses wider vectors where the CPU has them. A kernel's body is written once as an AOC_KERNEL_INLINE function,
+// and each variant is a thin wrapper carrying one of the AOC_TARGET_* attributes, into which the body is inlined and
+// vectorised for that ISA:
+//
+//     AOC_KERNEL_INLINE void SumBody(...) { ... }
+//     void SumScalar(...) { SumBody(...); }
+//     AOC_TARGET_AVX2 void SumAvx2(...) { SumBody(...); }
+//
+//     static auto* const sum = KernelVariants<decltype(SumScalar)>{SumScalar, nullptr, SumAvx2}.Select();
+//
+// The tiers match the x86-64 microarchitecture levels v2, v3 and v4. Setting $AOC_ISA to scalar, sse4.2, avx2 or
+// avx512 caps the choice, for comparing variants; asking for more than the CPU has gets the best it does have.
+// Elsewhere than x86 with GCC or Clang, everything runs the scalar variant.
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string_view>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#   define AOC_X86_DISPATCH true
+#   define AOC_TARGET_SSE42 __attribute__((target("sse4.2,popcnt")))
+#   define AOC_TARGET_AVX2 __attribute__((target("avx2,bmi,bmi2,fma,popcnt")))
+#   define AOC_TARGET_AVX512 \
+        __attribute__((target("avx512f,avx512bw,avx512cd,avx512dq,avx512vl,avx2,bmi,bmi2,fma,popcnt")))
+#else
+#   define AOC_X86_DISPATCH false
+#   define AOC_TARGET_SSE42
+#   define AOC_TARGET_AVX2
+#   define AOC_TARGET_AVX512
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#   define AOC_KERNEL_INLINE [[gnu::always_inline]] inline
+#else
+#   define AOC_KERNEL_INLINE inline
+#endif
+
+enum class Isa : uint8_t {
+    Scalar,
+    Sse42,
+    Avx2,
+    Avx512,
+};
+
+namespace isa_detail {
+    inline constexpr std::array<std::string_view, 4> names = {"scalar", "sse4.2", "avx2", "avx512"};
+
+    [[nodiscard]] inline Isa Detect() noexcept {
+#if AOC_X86_DISPATCH
+        __builtin_cpu_init();
+        const auto v2 = __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt");
+        const auto v3 = v2 && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi") &&
+                        __builtin_cpu_supports("bmi2") && __builtin_cpu_supports("fma");
+        const auto v4 = v3 && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+                        __builtin_cpu_supports("avx512cd") && __builtin_cpu_supports("avx512dq") &&
+                        __builtin_cpu_supports("avx512vl");
+        return v4 ? Isa::Avx512 : v3 ? Isa::Avx2 : v2 ? Isa::Sse42 : Isa::Scalar;
+#else
+        return Isa::Scalar;
+#endif
+    }
+
+    [[nodiscard]] inline std::optional<Isa> Parse(std::string_view name) noexcept {
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (names[i] == name)
+                return static_cast<Isa>(i);
+        }
+        return std::nullopt;
+    }
+}
+
+[[nodiscard]] inline std::string_view IsaName(Isa isa) noexcept {
+    return isa_detail::names[static_cast<size_t>(isa)];
+}
+
+// The ISA kernels are selected for, worked out once per process.
+[[nodiscard]] inline Isa ActiveIsa() {
+    static const Isa active = [] {
+        const auto supported = isa_detail::Detect();
+        const auto* env = std::getenv("AOC_ISA");
+        if (!env || !*env)
+            return supported;
+        const auto requested = isa_detail::Parse(env);
+        if (!requested) {
+            std::cerr << "Ignoring unknown AOC_ISA \"" << env << "\"; using " << IsaName(supported) << ".\n";
+            return supported;
+        }
+        if (*requested > supported) {
+            std::cerr << "This CPU doesn't support " << IsaName(*requested) << "; using " << IsaName(supported) << ".\n";
+            return supported;
+        }
+        return *requested;
+    }();
+    return active;
+}
+
+// One kernel's variants. Only the scalar one is required; a missing variant falls back to the next tier down.
+template <class Fn>
+struct KernelVariants {
+    Fn* scalar;
+    Fn* sse42 = nullptr;
+    Fn* avx2 = nullptr;
+    Fn* avx512 = nullptr;
+
+    [[nodiscard]] Fn* Select(Isa isa = ActiveIsa()) const noexcept {
+        const std::array<Fn*, 4> tiers = {scalar, sse42, avx2, avx512};
+        for (auto i = static_cast<size_t>(isa); i > 0; --i) {
+            if (tiers[i])
+                return tiers[i];
+        }
+        return scalar;
+    }
+};
@@ -0,0 +1,468 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) && __has_include(<emmintrin.h>)
+#   include <emmintrin.h>
+#   define HAVE_SSE2_GROUPS true
+#else
+#   define HAVE_SSE2_GROUPS false
+#endif
+
+// MurmurHash3's 64-bit finaliser. Hashers such as std::hash<int> are the identity on libstdc++, which would leave
+// the probe start and the control byte of a key depending on the same handful of low bits.
+[[nodiscard]] constexpr uint64_t MixHash(uint64_t h) noexcept {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDull;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// Open-addressing hash table in the style of SwissTable. Each slot has a control byte holding either 7 bits of its
+// key's hash or an empty/deleted marker, and a whole group of control bytes is compared against a key at once
+// (16 with SSE2, 8 with plain 64-bit arithmetic otherwise), so the slots themselves are only touched on a likely
+// match. Elements are stored inline and move on rehash: references and iterators don't survive an insertion.
+// Use FlatHashMap or FlatHashSet rather than naming this directly; a Value of void makes it a set. The allocator is
+// rebound for both arrays and follows the usual propagation rules, so a std::pmr allocator keeps a table (and, via
+// uses-allocator construction, allocator-aware elements) inside one arena.
+template <class Key, class Value, class Hash, class KeyEqual, class Allocator>
+class FlatHashTable {
+    static constexpr bool isMap = !std::is_void_v<Value>;
+public:
+    using key_type = Key;
+    using value_type = std::conditional_t<isMap, std::pair<const Key, std::conditional_t<isMap, Value, char>>, Key>;
+    using size_type = size_t;
+    using allocator_type = Allocator;
+private:
+    using SlotAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<value_type>;
+    using SlotTraits = std::allocator_traits<SlotAllocator>;
+    using CtrlAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<int8_t>;
+
+    static constexpr int8_t emptySlot = -128;
+    static constexpr int8_t deletedSlot = -2;
+
+    class Group {
+#if HAVE_SSE2_GROUPS
+        __m128i ctrl;
+    public:
+        static constexpr size_t width = 16;
+        static constexpr int shift = 0;
+
+        explicit Group(const int8_t* pos) noexcept : ctrl{_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos))} {}
+
+        [[nodiscard]] uint32_t Match(int8_t h2) const noexcept {
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl));
+        }
+
+        [[nodiscard]] uint32_t MatchEmpty() const noexcept {
+            return Match(emptySlot);
+        }
+
+        [[nodiscard]] uint32_t MatchFree() const noexcept {
+            return _mm_movemask_epi8(ctrl);
+        }
+#else
+        static constexpr uint64_t lsbs = 0x0101010101010101ull;
+        static constexpr uint64_t msbs = 0x8080808080808080ull;
+        uint64_t ctrl;
+    public:
+        static constexpr size_t width = 8;
+        static constexpr int shift = 3;
+
+        explicit Group(const int8_t* pos) noexcept {
+            std::memcpy(&ctrl, pos, sizeof(ctrl));
+        }
+
+        // May report the odd false positive next to a true match, which the key comparison weeds out.
+        [[nodiscard]] uint64_t Match(int8_t h2) const noexcept {
+            auto x = ctrl ^ (lsbs * static_cast<uint8_t>(h2));
+            return (x - lsbs) & ~x & msbs;
+        }
+
+        [[nodiscard]] uint64_t MatchEmpty() const noexcept {
+            return ctrl & (~ctrl << 6) & msbs;
+        }
+
+        [[nodiscard]] uint64_t MatchFree() const noexcept {
+            return ctrl & msbs;
+        }
+#endif
+    };
+
+    template <bool Const>
+    class Iterator {
+        friend class FlatHashTable;
+        using Table = std::conditional_t<Const, const FlatHashTable, FlatHashTable>;
+        Table* table = nullptr;
+        size_t idx = 0;
+
+        Iterator(Table* table, size_t idx) noexcept : table{table}, idx{idx} {}
+
+        void SkipFree() noexcept {
+            while (idx < table->capacity && table->ctrl[idx] < 0)
+                ++idx;
+        }
+    public:
+        using iterator_concept = std::forward_iterator_tag;
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = FlatHashTable::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<Const || !isMap, const value_type*, value_type*>;
+        using reference = std::conditional_t<Const || !isMap, const value_type&, value_type&>;
+
+        Iterator() noexcept = default;
+
+        operator Iterator<true>() const noexcept {
+            return {table, idx};
+        }
+
+        [[nodiscard]] reference operator*() const noexcept {
+            return table->slots[idx];
+        }
+
+        [[nodiscard]] pointer operator->() const noexcept {
+            return &table->slots[idx];
+        }
+
+        Iterator& operator++() noexcept {
+            ++idx;
+            SkipFree();
+            return *this;
+        }
+
+        Iterator operator++(int) noexcept {
+            auto ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        [[nodiscard]] bool operator==(const Iterator& rhs) const noexcept {
+            return idx == rhs.idx;
+        }
+    };
+public:
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+private:
+    int8_t* ctrl = nullptr;
+    value_type* slots = nullptr;
+    size_t capacity = 0;
+    size_t count = 0;
+    size_t growthLeft = 0;
+    [[no_unique_address]] Hash hasher;
+    [[no_unique_address]] KeyEqual equal;
+    [[no_unique_address]] SlotAllocator alloc;
+
+    [[nodiscard]] static const Key& KeyOf(const value_type& value) noexcept {
+        if constexpr (isMap)
+            return value.first;
+        else
+            return value;
+    }
+
+    [[nodiscard]] static constexpr size_t MaxLoad(size_t capacity) noexcept {
+        return capacity - capacity / 8;
+    }
+
+    [[nodiscard]] uint64_t HashOf(const Key& key) const noexcept {
+        return MixHash(hasher(key));
+    }
+
+    static constexpr size_t keepProbing = SIZE_MAX;
+
+    // Walks the groups in triangular order, which visits each of them once for a power-of-two group count, until
+    // func returns something other than keepProbing.
+    template <class Func>
+    [[nodiscard]] size_t Probe(uint64_t hash, Func&& func) const noexcept {
+        const auto groupMask = capacity / Group::width - 1;
+        for (size_t group = (hash >> 7) & groupMask, step = 1;; group = (group + step++) & groupMask) {
+            if (auto idx = func(group * Group::width, Group{ctrl + group * Group::width}); idx != keepProbing)
+                return idx;
+        }
+    }
+
+    [[nodiscard]] size_t FindIndex(const Key& key) const noexcept {
+        if (capacity == 0)
+            return 0;
+        const auto hash = HashOf(key);
+        const auto h2 = static_cast<int8_t>(hash & 0x7F);
+        return Probe(hash, [this, &key, h2] (size_t base, const Group& group) {
+            for (auto match = group.Match(h2); match; match &= match - 1) {
+                auto idx = base + (std::countr_zero(match) >> Group::shift);
+                if (ctrl[idx] == h2 && equal(KeyOf(slots[idx]), key))
+                    return idx;
+            }
+            return group.MatchEmpty() ? capacity : keepProbing;
+        });
+    }
+
+    [[nodiscard]] size_t FindFree(uint64_t hash) const noexcept {
+        return Probe(hash, [this] (size_t base, const Group& group) {
+            auto match = group.MatchFree();
+            return match ? base + (std::countr_zero(match) >> Group::shift) : keepProbing;
+        });
+    }
+
+    // Places a value known to be absent, returning its slot.
+    size_t Insert(uint64_t hash, value_type&& value) {
+        if (capacity == 0)
+            Rehash(Group::width);
+        auto idx = FindFree(hash);
+        if (ctrl[idx] == emptySlot && growthLeft == 0) {
+            Rehash(count + 1 > MaxLoad(capacity) / 2 ? std::max(capacity * 2, Group::width) : capacity);
+            idx = FindFree(hash);
+        }
+        growthLeft -= ctrl[idx] == emptySlot;
+        ctrl[idx] = static_cast<int8_t>(hash & 0x7F);
+        SlotTraits::construct(alloc, slots + idx, std::move(value));
+        ++count;
+        return idx;
+    }
+
+    void Allocate(size_t newCapacity) {
+        capacity = newCapacity;
+        ctrl = CtrlAllocator{alloc}.allocate(capacity);
+        std::memset(ctrl, emptySlot, capacity);
+        slots = SlotTraits::allocate(alloc, capacity);
+        growthLeft = MaxLoad(capacity);
+    }
+
+    void Deallocate(int8_t* oldCtrl, value_type* oldSlots, size_t oldCapacity) noexcept {
+        SlotTraits::deallocate(alloc, oldSlots, oldCapacity);
+        CtrlAllocator{alloc}.deallocate(oldCtrl, oldCapacity);
+    }
+
+    void Release() noexcept {
+        if (capacity == 0)
+            return;
+        for (size_t i = 0; i < capacity; ++i) {
+            if (ctrl[i] >= 0)
+                SlotTraits::destroy(alloc, slots + i);
+        }
+        Deallocate(ctrl, slots, capacity);
+        ctrl = nullptr;
+        slots = nullptr;
+        capacity = count = growthLeft = 0;
+    }
+
+    void Rehash(size_t newCapacity) {
+        auto oldCtrl = ctrl;
+        auto oldSlots = slots;
+        auto oldCapacity = capacity;
+        Allocate(newCapacity);
+        count = 0;
+        for (size_t i = 0; i < oldCapacity; ++i) {
+            if (oldCtrl[i] >= 0) {
+                Insert(HashOf(KeyOf(oldSlots[i])), std::move(oldSlots[i]));
+                SlotTraits::destroy(alloc, oldSlots + i);
+            }
+        }
+        if (oldCapacity != 0)
+            Deallocate(oldCtrl, oldSlots, oldCapacity);
+    }
+
+    void CopyFrom(const FlatHashTable& rhs) {
+        if (rhs.capacity == 0)
+            return;
+        Allocate(rhs.capacity);
+        std::memcpy(ctrl, rhs.ctrl, capacity);
+        for (size_t i = 0; i < capacity; ++i) {
+            if (ctrl[i] >= 0)
+                SlotTraits::construct(alloc, slots + i, rhs.slots[i]);
+        }
+        count = rhs.count;
+        growthLeft = rhs.growthLeft;
+    }
+
+    // Takes rhs's arrays when the allocators are interchangeable, and otherwise moves its elements across one by one.
+    void MoveFrom(FlatHashTable& rhs) {
+        if (alloc == rhs.alloc) {
+            ctrl = std::exchange(rhs.ctrl, nullptr);
+            slots = std::exchange(rhs.slots, nullptr);
+            capacity = std::exchange(rhs.capacity, 0);
+            count = std::exchange(rhs.count, 0);
+            growthLeft = std::exchange(rhs.growthLeft, 0);
+            return;
+        }
+        reserve(rhs.count);
+        for (size_t i = 0; i < rhs.capacity; ++i) {
+            if (rhs.ctrl[i] >= 0)
+                Insert(HashOf(KeyOf(rhs.slots[i])), std::move(rhs.slots[i]));
+        }
+        rhs.Release();
+    }
+public:
+    FlatHashTable() noexcept = default;
+
+    explicit FlatHashTable(const Allocator& alloc) noexcept : alloc{alloc} {}
+
+    explicit FlatHashTable(size_t expected, const Allocator& alloc = Allocator{}) : alloc{alloc} {
+        reserve(expected);
+    }
+
+    FlatHashTable(const FlatHashTable& rhs) :
+        hasher{rhs.hasher}, equal{rhs.equal}, alloc{SlotTraits::select_on_container_copy_construction(rhs.alloc)} {
+        CopyFrom(rhs);
+    }
+
+    FlatHashTable(const FlatHashTable& rhs, const Allocator& alloc) :
+        hasher{rhs.hasher}, equal{rhs.equal}, alloc{alloc} {
+        CopyFrom(rhs);
+    }
+
+    FlatHashTable(FlatHashTable&& rhs) noexcept : hasher{rhs.hasher}, equal{rhs.equal}, alloc{rhs.alloc} {
+        MoveFrom(rhs);
+    }
+
+    FlatHashTable(FlatHashTable&& rhs, const Allocator& alloc) :
+        hasher{rhs.hasher}, equal{rhs.equal}, alloc{alloc} {
+        MoveFrom(rhs);
+    }
+
+    FlatHashTable& operator=(FlatHashTable&& rhs) noexcept(SlotTraits::is_always_equal::value ||
+                                                           SlotTraits::propagate_on_container_move_assignment::value) {
+        if (this == &rhs)
+            return *this;
+        Release();
+        hasher = rhs.hasher;
+        equal = rhs.equal;
+        if constexpr (SlotTraits::propagate_on_container_move_assignment::value)
+            alloc = rhs.alloc;
+        MoveFrom(rhs);
+        return *this;
+    }
+
+    FlatHashTable& operator=(const FlatHashTable& rhs) {
+        if (this == &rhs)
+            return *this;
+        Release();
+        hasher = rhs.hasher;
+        equal = rhs.equal;
+        if constexpr (SlotTraits::propagate_on_container_copy_assignment::value)
+            alloc = rhs.alloc;
+        CopyFrom(rhs);
+        return *this;
+    }
+
+    ~FlatHashTable() {
+        Release();
+    }
+
+    [[nodiscard]] allocator_type get_allocator() const noexcept {
+        return allocator_type{alloc};
+    }
+
+    [[nodiscard]] size_t size() const noexcept {
+        return count;
+    }
+
+    [[nodiscard]] bool empty() const noexcept {
+        return count == 0;
+    }
+
+    void reserve(size_t expected) {
+        auto needed = std::bit_ceil(std::max(expected + expected / 7 + 1, Group::width));
+        if (needed > capacity)
+            Rehash(needed);
+    }
+
+    void clear() noexcept {
+        Release();
+    }
+
+    [[nodiscard]] iterator begin() noexcept {
+        iterator it{this, 0};
+        it.SkipFree();
+        return it;
+    }
+
+    [[nodiscard]] const_iterator begin() const noexcept {
+        const_iterator it{this, 0};
+        it.SkipFree();
+        return it;
+    }
+
+    [[nodiscard]] iterator end() noexcept {
+        return {this, capacity};
+    }
+
+    [[nodiscard]] const_iterator end() const noexcept {
+        return {this, capacity};
+    }
+
+    // The elements in the part'th of parts equal spans of slots, so that a scan can be split between threads.
+    [[nodiscard]] std::ranges::subrange<const_iterator> Segment(size_t part, size_t parts) const noexcept {
+        const_iterator first{this, capacity * part / parts}, last{this, capacity * (part + 1) / parts};
+        first.SkipFree();
+        last.SkipFree();
+        return {first, last};
+    }
+
+    [[nodiscard]] iterator find(const Key& key) noexcept {
+        return {this, FindIndex(key)};
+    }
+
+    [[nodiscard]] const_iterator find(const Key& key) const noexcept {
+        return {this, FindIndex(key)};
+    }
+
+    [[nodiscard]] bool contains(const Key& key) const noexcept {
+        return FindIndex(key) != capacity;
+    }
+
+    template <class... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        value_type value(std::forward<Args>(args)...);
+        if (auto idx = FindIndex(KeyOf(value)); idx != capacity)
+            return {{this, idx}, false};
+        return {{this, Insert(HashOf(KeyOf(value)), std::move(value))}, true};
+    }
+
+    template <class K, class... Args>
+    std::pair<iterator, bool> try_emplace(K&& key, Args&&... args) requires isMap {
+        if (auto idx = FindIndex(key); idx != capacity)
+            return {{this, idx}, false};
+        const auto hash = HashOf(key);
+        return {{this, Insert(hash, value_type(std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)),
+                                               std::forward_as_tuple(std::forward<Args>(args)...)))}, true};
+    }
+
+    template <class K>
+    auto& operator[](K&& key) requires isMap {
+        return try_emplace(std::forward<K>(key)).first->second;
+    }
+
+    void erase(const_iterator pos) noexcept {
+        SlotTraits::destroy(alloc, slots + pos.idx);
+        ctrl[pos.idx] = deletedSlot;
+        --count;
+    }
+
+    size_t erase(const Key& key) noexcept {
+        auto pos = find(key);
+        if (pos == end())
+            return 0;
+        erase(pos);
+        return 1;
+    }
+};
+
+template <class Key, class Value, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>,
+          class Allocator = std::allocator<std::byte>>
+using FlatHashMap = FlatHashTable<Key, Value, Hash, KeyEqual, Allocator>;
+
+template <class Key, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>,
+          class Allocator = std::allocator<std::byte>>
+using FlatHashSet = FlatHashTable<Key, void, Hash, KeyEqual, Allocator>;
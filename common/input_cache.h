@@ -0,0 +1,286 @@
+#pragma once
+
+// Optional on-disk cache of parsed inputs, switched on by pointing $AOC_CACHE_DIR at a writable directory. A day
+// serialises its parsed representation through CacheWriter after the first run; later runs map the entry and hand
+// its arrays straight back through CacheReader, skipping the text parse.
+//
+// Entries are keyed by the input's absolute path, size and modification time, and carry both a container version
+// and the day's own layout version, so any change to either the input or the layout simply misses. The payload is
+// checksummed, and anything that fails validation is ignored and rewritten.
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#if __has_include(<sys/mman.h>)
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#   define AOC_CACHE_MMAP true
+#else
+#   define AOC_CACHE_MMAP false
+#endif
+
+namespace cache_detail {
+    // Every array starts on this boundary, so spans handed out of the mapping are suitably aligned.
+    inline constexpr size_t alignment = alignof(std::max_align_t);
+
+    [[nodiscard]] constexpr size_t AlignUp(size_t offset) noexcept {
+        return (offset + alignment - 1) & ~(alignment - 1);
+    }
+
+    // A word at a time multiply-xor hash; it only needs to catch torn writes and stray corruption.
+    [[nodiscard]] inline uint64_t Checksum(std::span<const std::byte> bytes) noexcept {
+        constexpr uint64_t multiplier = 0x9E3779B97F4A7C15ull;
+        uint64_t hash = bytes.size() * multiplier;
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= bytes.size(); i += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, bytes.data() + i, sizeof(word));
+            hash = std::rotl((hash ^ word) * multiplier, 29);
+        }
+        uint64_t tail = 0;
+        std::memcpy(&tail, bytes.data() + i, bytes.size() - i);
+        return (hash ^ tail) * multiplier;
+    }
+}
+
+class CacheWriter {
+    std::vector<std::byte> bytes;
+
+    void Pad() {
+        bytes.resize(cache_detail::AlignUp(bytes.size()));
+    }
+public:
+    template <class T>
+        requires std::is_trivially_copyable_v<T>
+    void Write(const T& value) {
+        WriteSpan(std::span<const T>{&value, 1});
+    }
+
+    // Stored as a count followed by the elements, each array starting on an aligned boundary.
+    template <class T>
+        requires std::is_trivially_copyable_v<T>
+    void WriteSpan(std::span<const T> values) {
+        const uint64_t count = values.size();
+        Pad();
+        const auto* countBytes = reinterpret_cast<const std::byte*>(&count);
+        bytes.insert(bytes.end(), countBytes, countBytes + sizeof(count));
+        Pad();
+        const auto* data = reinterpret_cast<const std::byte*>(values.data());
+        bytes.insert(bytes.end(), data, data + values.size_bytes());
+    }
+
+    void WriteString(std::string_view text) {
+        WriteSpan(std::span<const char>{text.data(), text.size()});
+    }
+
+    [[nodiscard]] std::span<const std::byte> Bytes() const noexcept {
+        return bytes;
+    }
+};
+
+// Reads back what a CacheWriter wrote, in the same order. Spans point into the cache entry itself and stay valid
+// for as long as the InputCache that produced the reader.
+class CacheReader {
+    std::span<const std::byte> bytes;
+    size_t pos = 0;
+
+    [[nodiscard]] const std::byte* Take(size_t size) {
+        pos = cache_detail::AlignUp(pos);
+        if (size > bytes.size() - std::min(pos, bytes.size()))
+            throw std::runtime_error{"Cache entry is shorter than its layout."};
+        const auto* ret = bytes.data() + pos;
+        pos += size;
+        return ret;
+    }
+public:
+    explicit CacheReader(std::span<const std::byte> bytes) noexcept : bytes{bytes} {}
+
+    template <class T>
+        requires std::is_trivially_copyable_v<T>
+    [[nodiscard]] T Read() {
+        auto values = ReadSpan<T>();
+        if (values.size() != 1)
+            throw std::runtime_error{"Cache entry doesn't match its layout."};
+        return values.front();
+    }
+
+    template <class T>
+        requires std::is_trivially_copyable_v<T>
+    [[nodiscard]] std::span<const T> ReadSpan() {
+        uint64_t count;
+        std::memcpy(&count, Take(sizeof(count)), sizeof(count));
+        if (count > bytes.size() / sizeof(T))
+            throw std::runtime_error{"Cache entry is shorter than its layout."};
+        return {reinterpret_cast<const T*>(Take(count * sizeof(T))), static_cast<size_t>(count)};
+    }
+
+    [[nodiscard]] std::string_view ReadString() {
+        auto chars = ReadSpan<char>();
+        return {chars.data(), chars.size()};
+    }
+};
+
+class InputCache {
+    static constexpr char magic[8] = {'A', 'O', 'C', 'C', 'A', 'C', 'H', 'E'};
+    static constexpr uint32_t containerVersion = 1;
+
+    struct Header {
+        char magic[8];
+        uint32_t containerVersion;
+        uint32_t layoutVersion;
+        char tag[16];
+        uint64_t pathHash;
+        uint64_t inputSize;
+        int64_t inputModified;
+        uint64_t payloadSize;
+        uint64_t checksum;
+    };
+    static constexpr size_t payloadOffset = cache_detail::AlignUp(sizeof(Header));
+
+    std::filesystem::path path; // Empty when caching is off or the input can't be keyed.
+    Header key{};
+    const std::byte* data = nullptr;
+    size_t size = 0;
+#if !AOC_CACHE_MMAP
+    std::vector<char> buffer;
+#endif
+
+    [[nodiscard]] static uint64_t HashPath(const std::string& text) noexcept {
+        uint64_t hash = 0xCBF29CE484222325ull;
+        for (auto c : text)
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001B3ull;
+        return hash;
+    }
+
+    void Unmap() noexcept {
+#if AOC_CACHE_MMAP
+        if (data)
+            munmap(const_cast<std::byte*>(data), size);
+#else
+        buffer.clear();
+#endif
+        data = nullptr;
+        size = 0;
+    }
+
+    [[nodiscard]] bool Map() {
+#if AOC_CACHE_MMAP
+        const auto fd = open(path.c_str(), O_RDONLY);
+        if (fd == -1)
+            return false;
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            auto* mem = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mem != MAP_FAILED) {
+                data = static_cast<const std::byte*>(mem);
+                size = info.st_size;
+            }
+        }
+        close(fd);
+#else
+        std::ifstream in{path, std::ios_base::binary};
+        buffer.assign(std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{});
+        data = reinterpret_cast<const std::byte*>(buffer.data());
+        size = buffer.size();
+#endif
+        return data != nullptr;
+    }
+public:
+    // tag names the day and layoutVersion must be bumped whenever what it writes changes shape. Only regular files
+    // are cached: stdin, pipes and FIFOs have no size or modification time to key an entry on.
+    InputCache(const char* input, std::string_view tag, uint32_t layoutVersion) {
+        const auto* dir = std::getenv("AOC_CACHE_DIR");
+        if (!dir || !*dir || tag.size() >= sizeof(key.tag) || std::string_view{input} == "-")
+            return;
+        std::error_code ec;
+        const auto absolute = std::filesystem::absolute(input, ec);
+        if (!ec && !std::filesystem::is_regular_file(absolute, ec))
+            return;
+        if (!ec)
+            key.inputSize = std::filesystem::file_size(absolute, ec);
+        if (!ec)
+            key.inputModified = std::filesystem::last_write_time(absolute, ec).time_since_epoch().count();
+        if (ec)
+            return;
+        std::memcpy(key.magic, magic, sizeof(magic));
+        key.containerVersion = containerVersion;
+        key.layoutVersion = layoutVersion;
+        std::memcpy(key.tag, tag.data(), tag.size());
+        key.pathHash = HashPath(absolute.string());
+        char name[17];
+        std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key.pathHash));
+        path = std::filesystem::path{dir} / (std::string{tag} + '-' + name + ".cache");
+    }
+    InputCache(const InputCache&) = delete;
+    InputCache& operator=(const InputCache&) = delete;
+
+    ~InputCache() {
+        Unmap();
+    }
+
+    // A reader over the entry for this input, or nothing if caching is off or there's no valid entry.
+    [[nodiscard]] std::optional<CacheReader> Open() {
+        if (path.empty() || !Map())
+            return std::nullopt;
+        Header header;
+        if (size >= payloadOffset) {
+            std::memcpy(&header, data, sizeof(header));
+            // Everything ahead of payloadSize is the key.
+            if (std::memcmp(&header, &key, offsetof(Header, payloadSize)) == 0 &&
+                header.payloadSize == size - payloadOffset) {
+                const std::span payload{data + payloadOffset, size - payloadOffset};
+                if (cache_detail::Checksum(payload) == header.checksum)
+                    return CacheReader{payload};
+            }
+        }
+        Unmap();
+        return std::nullopt;
+    }
+
+    // Writes value's Save output as this input's entry. It goes to a temporary file first and is renamed into
+    // place, so a concurrent or interrupted run never sees half an entry. Failing to write only costs the cache.
+    template <class T>
+    void Store(const T& value) {
+        if (path.empty())
+            return;
+        CacheWriter writer;
+        value.Save(writer);
+        auto header = key;
+        header.payloadSize = writer.Bytes().size();
+        header.checksum = cache_detail::Checksum(writer.Bytes());
+        auto temp = path;
+        temp += ".tmp" + std::to_string(std::random_device{}());
+        {
+            std::ofstream out{temp, std::ios_base::binary | std::ios_base::trunc};
+            const char padding[payloadOffset - sizeof(Header) + 1] = {};
+            out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            out.write(padding, payloadOffset - sizeof(Header));
+            out.write(reinterpret_cast<const char*>(writer.Bytes().data()), writer.Bytes().size());
+            if (!out)
+                return;
+        }
+        std::error_code ec;
+        std::filesystem::rename(temp, path, ec);
+        if (ec)
+            std::filesystem::remove(temp, ec);
+    }
+};
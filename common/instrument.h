@@ -0,0 +1,192 @@
+#pragma once
+
+// Hot-path instrumentation, compiled in only when configured with -DAOC_INSTRUMENT=ON. Otherwise every macro below
+// expands to nothing and its arguments aren't evaluated.
+//
+//   AOC_COUNT(name) / AOC_COUNT_N(name, n)  add to an event counter
+//   AOC_HISTOGRAM(name, value)              record a value in a log2-bucketed histogram
+//   AOC_TIME_SCOPE(name)                    time the rest of the enclosing scope
+//
+// The report is written as JSON when the process exits, to the file named by $AOC_INSTRUMENT_OUT or to stderr.
+
+#if AOC_INSTRUMENT
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+// Process-wide registry of named metrics. Each instrumented site looks its entry up once, caching the reference in
+// a function-local static, after which recording is a relaxed atomic add so worker threads can share entries.
+class Instrumentation {
+public:
+    class Counter {
+        std::atomic<uint64_t> value = 0;
+        friend class Instrumentation;
+    public:
+        void Add(uint64_t n) noexcept {
+            value.fetch_add(n, std::memory_order_relaxed);
+        }
+    };
+
+    class Timer {
+        std::atomic<uint64_t> calls = 0;
+        std::atomic<uint64_t> nanoseconds = 0;
+        friend class Instrumentation;
+    public:
+        void Add(std::chrono::nanoseconds elapsed) noexcept {
+            calls.fetch_add(1, std::memory_order_relaxed);
+            nanoseconds.fetch_add(elapsed.count(), std::memory_order_relaxed);
+        }
+    };
+
+    // Bucket i holds values whose bit width is i, so bucket 0 is exactly 0 and bucket i > 0 covers [2^(i-1), 2^i).
+    class Histogram {
+        std::atomic<uint64_t> count = 0;
+        std::atomic<uint64_t> sum = 0;
+        std::atomic<uint64_t> max = 0;
+        std::array<std::atomic<uint64_t>, 65> buckets{};
+        friend class Instrumentation;
+    public:
+        void Record(uint64_t value) noexcept {
+            count.fetch_add(1, std::memory_order_relaxed);
+            sum.fetch_add(value, std::memory_order_relaxed);
+            buckets[std::bit_width(value)].fetch_add(1, std::memory_order_relaxed);
+            for (auto seen = max.load(std::memory_order_relaxed);
+                 seen < value && !max.compare_exchange_weak(seen, value, std::memory_order_relaxed););
+        }
+    };
+
+    class ScopedTimer {
+        Timer& timer;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    public:
+        explicit ScopedTimer(Timer& timer) noexcept : timer{timer} {}
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+        ~ScopedTimer() {
+            timer.Add(std::chrono::steady_clock::now() - start);
+        }
+    };
+private:
+    template <class T>
+    using Registry = std::map<std::string, std::unique_ptr<T>, std::less<>>;
+
+    std::mutex mutex;
+    Registry<Counter> counters;
+    Registry<Timer> timers;
+    Registry<Histogram> histograms;
+
+    template <class T>
+    [[nodiscard]] T& Lookup(Registry<T>& registry, std::string_view name) {
+        std::lock_guard lock{mutex};
+        auto entry = registry.find(name);
+        if (entry == registry.end())
+            entry = registry.emplace(name, std::make_unique<T>()).first;
+        return *entry->second;
+    }
+
+    template <class T, class Func>
+    static void WriteSection(std::ostream& out, std::string_view section, const Registry<T>& registry, Func&& func) {
+        out << "  \"" << section << "\": {";
+        auto first = true;
+        for (auto& [name, metric] : registry) {
+            out << (first ? "\n" : ",\n") << "    \"" << name << "\": ";
+            func(*metric);
+            first = false;
+        }
+        out << (first ? "}" : "\n  }");
+    }
+
+    void Report(std::ostream& out) const {
+        constexpr auto relaxed = std::memory_order_relaxed;
+        out << "{\n";
+        WriteSection(out, "counters", counters, [&out] (const Counter& counter) {
+            out << counter.value.load(relaxed);
+        });
+        out << ",\n";
+        WriteSection(out, "timers", timers, [&out] (const Timer& timer) {
+            out << "{\"calls\": " << timer.calls.load(relaxed) << ", \"ns\": " << timer.nanoseconds.load(relaxed) << '}';
+        });
+        out << ",\n";
+        WriteSection(out, "histograms", histograms, [&out] (const Histogram& histogram) {
+            out << "{\"count\": " << histogram.count.load(relaxed) << ", \"sum\": " << histogram.sum.load(relaxed)
+                << ", \"max\": " << histogram.max.load(relaxed) << ", \"log2_buckets\": [";
+            auto last = histogram.buckets.size();
+            while (last > 1 && histogram.buckets[last - 1].load(relaxed) == 0)
+                --last;
+            for (size_t i = 0; i < last; ++i)
+                out << (i ? ", " : "") << histogram.buckets[i].load(relaxed);
+            out << "]}";
+        });
+        out << "\n}\n";
+    }
+
+    Instrumentation() = default;
+
+    ~Instrumentation() {
+        if (const auto* path = std::getenv("AOC_INSTRUMENT_OUT")) {
+            std::ofstream file{path};
+            Report(file);
+        } else {
+            Report(std::cerr);
+        }
+    }
+public:
+    [[nodiscard]] static Instrumentation& Get() {
+        static Instrumentation instance;
+        return instance;
+    }
+
+    [[nodiscard]] Counter& GetCounter(std::string_view name) {
+        return Lookup(counters, name);
+    }
+
+    [[nodiscard]] Timer& GetTimer(std::string_view name) {
+        return Lookup(timers, name);
+    }
+
+    [[nodiscard]] Histogram& GetHistogram(std::string_view name) {
+        return Lookup(histograms, name);
+    }
+};
+
+#define AOC_CONCAT_IMPL(a, b) a##b
+#define AOC_CONCAT(a, b) AOC_CONCAT_IMPL(a, b)
+
+#define AOC_COUNT_N(name, n) \
+    do { \
+        static auto& aocCounter = Instrumentation::Get().GetCounter(name); \
+        aocCounter.Add(n); \
+    } while (false)
+
+#define AOC_HISTOGRAM(name, value) \
+    do { \
+        static auto& aocHistogram = Instrumentation::Get().GetHistogram(name); \
+        aocHistogram.Record(value); \
+    } while (false)
+
+#define AOC_TIME_SCOPE(name) \
+    static auto& AOC_CONCAT(aocTimer, __LINE__) = Instrumentation::Get().GetTimer(name); \
+    const Instrumentation::ScopedTimer AOC_CONCAT(aocScope, __LINE__){AOC_CONCAT(aocTimer, __LINE__)}
+
+#else
+
+#define AOC_COUNT_N(name, n) ((void)0)
+#define AOC_HISTOGRAM(name, value) ((void)0)
+#define AOC_TIME_SCOPE(name) static_assert(true)
+
+#endif
+
+#define AOC_COUNT(name) AOC_COUNT_N(name, 1)
@@ -0,0 +1,206 @@
+#pragma once
+
+// Data-parallel loops and reductions on one process-wide thread pool, without needing TBB or a parallel standard
+// library. The calling thread always takes part in its own job, so a loop body may itself run a parallel loop, and
+// on a single core everything simply runs inline.
+//
+// Reductions combine their partial results in order, so reduce only needs to be associative. Configuring with
+// AOC_STD_EXECUTION instead hands random-access reductions to std::execution::par_unseq, for standard libraries
+// which parallelise it themselves; reduce must then be commutative as well.
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if __has_include(<unistd.h>)
+#   include <unistd.h>
+#endif
+
+#if AOC_STD_EXECUTION
+#   include <execution>
+#endif
+
+class ThreadPool {
+    // One parallel loop. Whoever gets to it first claims the next index, so late helpers find nothing left to do.
+    struct Job {
+        std::function<void(size_t)> body;
+        size_t count;
+        std::atomic<size_t> next = 0;
+        std::atomic<size_t> done = 0;
+        std::mutex errorMutex;
+        std::exception_ptr error;
+
+        Job(std::function<void(size_t)> body, size_t count) : body{std::move(body)}, count{count} {}
+
+        void Help() noexcept {
+            for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < count;) {
+                try {
+                    body(i);
+                } catch (...) {
+                    std::lock_guard lock{errorMutex};
+                    if (!error)
+                        error = std::current_exception();
+                }
+                if (done.fetch_add(1, std::memory_order_acq_rel) + 1 == count)
+                    done.notify_all();
+            }
+        }
+    };
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::shared_ptr<Job>> jobs;
+    bool stopping = false;
+    std::vector<std::jthread> workers;
+
+    void Work() {
+        while (true) {
+            std::shared_ptr<Job> job;
+            {
+                std::unique_lock lock{mutex};
+                ready.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+            }
+            job->Help();
+        }
+    }
+public:
+    explicit ThreadPool(size_t threads) {
+        for (size_t i = 0; i < threads; ++i)
+            workers.emplace_back([this] { Work(); });
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard lock{mutex};
+            stopping = true;
+        }
+        ready.notify_all();
+    }
+
+    // The calling thread counts as one of the cores, so the pool has a worker for each of the others.
+    [[nodiscard]] static ThreadPool& Shared() {
+        static ThreadPool pool{std::max(std::thread::hardware_concurrency(), 1u) - 1};
+        return pool;
+    }
+
+    // Threads that work on a job, counting the caller.
+    [[nodiscard]] size_t Concurrency() const noexcept {
+        return workers.size() + 1;
+    }
+
+    // Runs body(i) for every i in [0, count) and returns once they've all finished, rethrowing the first exception.
+    void Run(size_t count, std::function<void(size_t)> body) {
+        if (count == 0)
+            return;
+        auto job = std::make_shared<Job>(std::move(body), count);
+        if (const auto helpers = std::min(count - 1, workers.size()); helpers > 0) {
+            {
+                std::lock_guard lock{mutex};
+                jobs.insert(jobs.end(), helpers, job);
+            }
+            if (helpers == 1)
+                ready.notify_one();
+            else
+                ready.notify_all();
+        }
+        job->Help();
+        for (auto done = job->done.load(std::memory_order_acquire); done != count;
+             done = job->done.load(std::memory_order_acquire))
+            job->done.wait(done, std::memory_order_acquire);
+        if (job->error)
+            std::rethrow_exception(job->error);
+    }
+};
+
+namespace parallel_detail {
+    // Half the L2 cache, so each chunk streams through it with room to spare.
+    [[nodiscard]] inline size_t ChunkBytes() noexcept {
+        static const size_t bytes = [] {
+            long cache = 0;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+            cache = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+            return cache > 0 ? static_cast<size_t>(cache) / 2 : size_t{1} << 18;
+        }();
+        return bytes;
+    }
+}
+
+// How many pieces to split elements of elementBytes each into: one per cache-sized chunk, and just one if they fit.
+[[nodiscard]] inline size_t ChunksFor(size_t elements, size_t elementBytes) noexcept {
+    const auto perChunk = std::max<size_t>(parallel_detail::ChunkBytes() / std::max<size_t>(elementBytes, 1), 1);
+    return std::max<size_t>((elements + perChunk - 1) / perChunk, 1);
+}
+
+// Runs func(i) for every i in [0, count), split into one contiguous chunk per thread.
+template <class Func>
+void ParallelFor(size_t count, Func&& func) {
+    auto& pool = ThreadPool::Shared();
+    const auto threads = std::clamp<size_t>(pool.Concurrency(), 1, std::max<size_t>(count, 1));
+    const auto chunk = (count + threads - 1) / threads;
+    pool.Run(threads, [&func, count, chunk] (size_t part) {
+        for (auto i = part * chunk; i < std::min((part + 1) * chunk, count); ++i)
+            func(i);
+    });
+}
+
+// init combined, in order, with transform(i) for every i in [0, parts). Each part is one task.
+template <class T, class Reduce, class Transform>
+[[nodiscard]] T ParallelReduce(size_t parts, T init, Reduce reduce, Transform transform) {
+    if (parts <= 1)
+        return parts == 0 ? init : reduce(std::move(init), transform(size_t{0}));
+    std::vector<std::optional<T>> partials(parts);
+    ThreadPool::Shared().Run(parts, [&partials, &transform] (size_t part) {
+        partials[part].emplace(transform(part));
+    });
+    for (auto& partial : partials)
+        init = reduce(std::move(init), std::move(*partial));
+    return init;
+}
+
+// std::transform_reduce, spread over the pool in cache-sized chunks when the range is random access and spans more
+// than one. Smaller and forward-only ranges are reduced in place.
+template <std::forward_iterator It, class T, class Reduce, class Transform>
+[[nodiscard]] T ParallelTransformReduce(It first, It last, T init, Reduce reduce, Transform transform) {
+    if constexpr (std::random_access_iterator<It>) {
+        const auto size = static_cast<size_t>(last - first);
+        const auto parts = ChunksFor(size, sizeof(std::iter_value_t<It>));
+        if (parts > 1) {
+#if AOC_STD_EXECUTION
+            return std::transform_reduce(std::execution::par_unseq, first, last, std::move(init), reduce, transform);
+#else
+            const auto chunk = (size + parts - 1) / parts;
+            const auto sum = [first, size, chunk, &reduce, &transform] (size_t part) {
+                auto begin = first + part * chunk;
+                const auto end = first + std::min((part + 1) * chunk, size);
+                T ret = transform(*begin);
+                while (++begin != end)
+                    ret = reduce(std::move(ret), transform(*begin));
+                return ret;
+            };
+            return ParallelReduce(parts, std::move(init), reduce, sum);
+#endif
+        }
+    }
+    for (; first != last; ++first)
+        init = reduce(std::move(init), transform(*first));
+    return init;
+}
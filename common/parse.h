@@ -0,0 +1,156 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Locale-free decimal parsing. Digits are consumed eight at a time: the bytes are loaded as one little-endian word,
+// the run of leading digits is found with a handful of bitwise operations, and the run is converted with three
+// multiplies rather than one per digit.
+class DecimalParser {
+    static constexpr uint64_t ones = 0x0101010101010101ull;
+    static constexpr auto powersOf10 = [] {
+        std::array<uint64_t, 9> ret{1};
+        for (size_t i = 1; i < ret.size(); ++i)
+            ret[i] = ret[i - 1] * 10;
+        return ret;
+    }();
+
+    struct Chunk {
+        uint64_t value;
+        int digits;
+    };
+
+    // Bytes past `last` read as zero, which isn't a digit, so a short tail needs no special casing.
+    [[nodiscard]] static Chunk ParseChunk(const char* first, const char* last) noexcept {
+        if constexpr (std::endian::native != std::endian::little) {
+            Chunk ret{0, 0};
+            for (; ret.digits < 8 && first + ret.digits != last; ++ret.digits) {
+                const auto c = first[ret.digits];
+                if (c < '0' || c > '9')
+                    break;
+                ret.value = ret.value * 10 + (c - '0');
+            }
+            return ret;
+        } else {
+            uint64_t bytes = 0;
+            std::memcpy(&bytes, first, std::min<size_t>(last - first, sizeof(bytes)));
+            // A byte is a digit if its high nibble is 3 both before and after adding 6. Carries out of non-digit
+            // bytes only reach later bytes, which are past the run anyway.
+            const auto nonDigits = ((bytes & 0xF0 * ones) ^ 0x30 * ones) |
+                                   (((bytes + 0x06 * ones) & 0xF0 * ones) ^ 0x30 * ones);
+            const auto digits = std::countr_zero(nonDigits) / 8;
+            if (digits == 0)
+                return {0, 0};
+            // Left-align the run so the vacated low bytes act as leading zeroes, then combine pairs, quads and
+            // finally both halves.
+            auto v = (bytes & 0x0F * ones) << (8 * (8 - digits));
+            v = v * 10 + (v >> 8);
+            v = ((v & 0x000000FF000000FFull) * (100 + (1000000ull << 32)) +
+                 ((v >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32))) >> 32;
+            return {v, digits};
+        }
+    }
+public:
+    // Reads an unsigned magnitude; overflow only stops accumulation, the digits are still consumed.
+    [[nodiscard]] static std::from_chars_result ParseMagnitude(const char* first, const char* last,
+                                                               uint64_t& value) noexcept {
+        constexpr auto max = std::numeric_limits<uint64_t>::max();
+        uint64_t acc = 0;
+        auto overflow = false;
+        auto pos = first;
+        while (pos != last) {
+            const auto [chunk, digits] = ParseChunk(pos, last);
+            if (digits == 0)
+                break;
+            if (acc > (max - chunk) / powersOf10[digits])
+                overflow = true;
+            else
+                acc = acc * powersOf10[digits] + chunk;
+            pos += digits;
+            if (digits < 8)
+                break;
+        }
+        if (pos == first)
+            return {first, std::errc::invalid_argument};
+        if (overflow)
+            return {pos, std::errc::result_out_of_range};
+        value = acc;
+        return {pos, std::errc{}};
+    }
+};
+
+// Behaves like std::from_chars for base 10, except that signed types also accept a leading '+'.
+template <std::integral T>
+std::from_chars_result ParseInt(const char* first, const char* last, T& value) noexcept {
+    using Unsigned = std::make_unsigned_t<T>;
+    auto negative = false;
+    auto pos = first;
+    if constexpr (std::is_signed_v<T>) {
+        if (pos != last && (*pos == '-' || *pos == '+'))
+            negative = *pos++ == '-';
+    }
+    uint64_t magnitude;
+    auto ret = DecimalParser::ParseMagnitude(pos, last, magnitude);
+    if (ret.ec == std::errc::invalid_argument)
+        return {first, ret.ec};
+    const uint64_t limit = static_cast<Unsigned>(std::numeric_limits<T>::max()) + negative;
+    if (ret.ec == std::errc::result_out_of_range || magnitude > limit)
+        return {ret.ptr, std::errc::result_out_of_range};
+    value = static_cast<T>(negative ? Unsigned{0} - static_cast<Unsigned>(magnitude) : magnitude);
+    return ret;
+}
+
+// The whole of text as an integer, or nothing if it holds anything else or doesn't fit.
+template <std::integral T>
+[[nodiscard]] std::optional<T> ToInt(std::string_view text) noexcept {
+    T value;
+    const auto [pos, ec] = ParseInt(text.data(), text.data() + text.size(), value);
+    if (ec != std::errc{} || pos != text.data() + text.size())
+        return std::nullopt;
+    return value;
+}
+
+// Calls func(index, value) for each field of text, split on delim, that holds an integer. Other fields (such as
+// day 13's 'x') are skipped but still counted, and trailing whitespace is ignored.
+template <std::integral T, class Func>
+void ForEachInt(std::string_view text, char delim, Func&& func) {
+    while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back())))
+        text.remove_suffix(1);
+    for (size_t field = 0; !text.empty(); ++field) {
+        const auto end = std::min(text.find(delim), text.size());
+        T value;
+        const auto [pos, ec] = ParseInt(text.data(), text.data() + end, value);
+        if (ec == std::errc::result_out_of_range)
+            throw std::out_of_range{"Integer out of range: " + std::string{text.substr(0, end)}};
+        if (ec == std::errc{} && pos == text.data() + end)
+            func(field, value);
+        text.remove_prefix(std::min(end + 1, text.size()));
+    }
+}
+
+template <std::integral T>
+[[nodiscard]] std::vector<T> ParseInts(std::string_view text, char delim) {
+    std::vector<T> ret;
+    ForEachInt<T>(text, delim, [&ret] (size_t, T value) { ret.push_back(value); });
+    return ret;
+}
+
+// The rest of the stream, for parsing as a single span.
+[[nodiscard]] inline std::string ReadAll(std::istream& in) {
+    return {std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+}
@@ -0,0 +1,304 @@
+#pragma once
+
+// Producer/consumer pipeline for days whose records can be checked independently. A coroutine splits the input into
+// records on the calling thread, which packs them into batches and pushes them through a bounded lock-free queue to
+// a pool of workers. Each worker folds its records into its own result, and the results are merged at the end.
+//
+// A stage is any functor with a Result type, where Result is default-constructible and merges with +=:
+//
+//     struct Stage {
+//         using Result = ...;
+//         void operator()(std::string_view record, Result& result) const;
+//     };
+//
+// The stage is called concurrently, so it mustn't change shared state.
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "common/parse.h"
+
+template <class T>
+class Generator {
+public:
+    struct promise_type {
+        const T* current = nullptr;
+
+        Generator get_return_object() noexcept {
+            return Generator{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() const noexcept {
+            return {};
+        }
+
+        std::suspend_always final_suspend() const noexcept {
+            return {};
+        }
+
+        // The value is a temporary of the co_yield expression, which lives until the coroutine resumes.
+        std::suspend_always yield_value(const T& value) noexcept {
+            current = &value;
+            return {};
+        }
+
+        void return_void() const noexcept {}
+
+        void unhandled_exception() const {
+            throw;
+        }
+    };
+
+    class Iterator {
+        std::coroutine_handle<promise_type> coro;
+    public:
+        explicit Iterator(std::coroutine_handle<promise_type> coro) noexcept : coro{coro} {}
+
+        Iterator& operator++() {
+            coro.resume();
+            return *this;
+        }
+
+        [[nodiscard]] const T& operator*() const noexcept {
+            return *coro.promise().current;
+        }
+
+        [[nodiscard]] bool operator==(std::default_sentinel_t) const noexcept {
+            return coro.done();
+        }
+    };
+private:
+    std::coroutine_handle<promise_type> coro;
+
+    explicit Generator(std::coroutine_handle<promise_type> coro) noexcept : coro{coro} {}
+public:
+    Generator(Generator&& rhs) noexcept : coro{std::exchange(rhs.coro, {})} {}
+    Generator& operator=(Generator&&) = delete;
+
+    ~Generator() {
+        if (coro)
+            coro.destroy();
+    }
+
+    [[nodiscard]] Iterator begin() {
+        coro.resume();
+        return Iterator{coro};
+    }
+
+    [[nodiscard]] std::default_sentinel_t end() const noexcept {
+        return {};
+    }
+};
+
+// Every non-empty record in the rest of the stream. Each view is only valid until the next one is asked for.
+[[nodiscard]] inline Generator<std::string_view> Records(std::istream& in, std::string_view separator) {
+    constexpr size_t readSize = 1 << 16;
+    std::string buffer;
+    std::vector<char> chunk(readSize);
+    while (in) {
+        in.read(chunk.data(), chunk.size());
+        buffer.append(chunk.data(), in.gcount());
+        size_t start = 0;
+        for (size_t end; (end = buffer.find(separator, start)) != std::string::npos; start = end + separator.size()) {
+            if (end > start)
+                co_yield std::string_view{buffer}.substr(start, end - start);
+        }
+        buffer.erase(0, start);
+    }
+    if (!buffer.empty())
+        co_yield std::string_view{buffer};
+}
+
+// Vyukov's bounded multi-producer, multi-consumer queue. Each cell's sequence number says whose turn it is, so
+// pushes and pops only contend on the index they advance. Neither blocks: a full or empty queue is reported to the
+// caller, who decides how to wait.
+template <class T>
+class BoundedQueue {
+    static constexpr size_t cacheLine = 64;
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+    alignas(cacheLine) std::atomic<size_t> pushPos = 0;
+    alignas(cacheLine) std::atomic<size_t> popPos = 0;
+
+    // The cell at pos's turn once pos has been claimed from position, or nullptr if it isn't ready yet.
+    template <size_t lag>
+    [[nodiscard]] Cell* Claim(std::atomic<size_t>& position, size_t& pos) noexcept {
+        pos = position.load(std::memory_order_relaxed);
+        while (true) {
+            auto& cell = cells[pos & mask];
+            const auto diff = static_cast<intptr_t>(cell.sequence.load(std::memory_order_acquire) - (pos + lag));
+            if (diff < 0)
+                return nullptr;
+            if (diff == 0 && position.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                return &cell;
+            if (diff > 0)
+                pos = position.load(std::memory_order_relaxed);
+        }
+    }
+public:
+    explicit BoundedQueue(size_t capacity) : cells{new Cell[std::bit_ceil(std::max<size_t>(capacity, 2))]},
+                                             mask{std::bit_ceil(std::max<size_t>(capacity, 2)) - 1} {
+        for (size_t i = 0; i <= mask; ++i)
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    // Leaves value alone if the queue is full.
+    [[nodiscard]] bool TryPush(T& value) noexcept {
+        size_t pos;
+        auto* cell = Claim<0>(pushPos, pos);
+        if (!cell)
+            return false;
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    [[nodiscard]] std::optional<T> TryPop() noexcept {
+        size_t pos;
+        auto* cell = Claim<1>(popPos, pos);
+        if (!cell)
+            return std::nullopt;
+        std::optional<T> ret{std::move(cell->value)};
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return ret;
+    }
+};
+
+// Taken from AOC_PIPELINE_WORKERS, AOC_PIPELINE_BATCH (records per batch) and AOC_PIPELINE_QUEUE (batches in
+// flight before the reader waits) where set.
+struct PipelineOptions {
+    size_t workers = std::max(std::thread::hardware_concurrency(), 1u);
+    size_t batchRecords = 4096;
+    size_t queueBatches = 16;
+
+    [[nodiscard]] static PipelineOptions FromEnvironment() noexcept {
+        PipelineOptions ret;
+        const auto read = [] (const char* name, size_t& value) {
+            if (const auto* text = std::getenv(name)) {
+                if (auto parsed = ToInt<size_t>(text); parsed && *parsed > 0)
+                    value = *parsed;
+            }
+        };
+        read("AOC_PIPELINE_WORKERS", ret.workers);
+        read("AOC_PIPELINE_BATCH", ret.batchRecords);
+        read("AOC_PIPELINE_QUEUE", ret.queueBatches);
+        return ret;
+    }
+};
+
+// Records are copied in back to back, with their end offsets, so a batch owns everything its worker reads.
+class RecordBatch {
+    std::string text;
+    std::vector<uint32_t> ends;
+public:
+    void Add(std::string_view record) {
+        text.append(record);
+        ends.push_back(text.size());
+    }
+
+    [[nodiscard]] size_t Size() const noexcept {
+        return ends.size();
+    }
+
+    template <class Func>
+    void ForEach(Func&& func) const {
+        uint32_t start = 0;
+        for (auto end : ends) {
+            func(std::string_view{text}.substr(start, end - start));
+            start = end;
+        }
+    }
+};
+
+// The first exception a stage throws stops the pipeline and is rethrown here once every worker has finished, as is
+// anything thrown while reading records.
+template <class Stage>
+[[nodiscard]] typename Stage::Result RunPipeline(Generator<std::string_view> records, const Stage& stage,
+                                                 const PipelineOptions& options = PipelineOptions::FromEnvironment()) {
+    using Result = typename Stage::Result;
+    BoundedQueue<RecordBatch> queue{options.queueBatches};
+    std::atomic<bool> finished = false;
+    std::atomic<bool> failed = false;
+    std::vector<Result> results(options.workers);
+    std::vector<std::exception_ptr> errors(options.workers);
+    {
+        std::vector<std::jthread> workers;
+        // Runs before the workers are joined, however the reader leaves this scope, so that they don't wait forever.
+        struct FinishOnExit {
+            std::atomic<bool>& finished;
+
+            ~FinishOnExit() {
+                finished.store(true, std::memory_order_release);
+            }
+        } finishOnExit{finished};
+        for (size_t i = 0; i < options.workers; ++i) {
+            workers.emplace_back([&queue, &finished, &failed, &stage, &result = results[i], &error = errors[i]] {
+                try {
+                    Result local{};
+                    while (!failed.load(std::memory_order_relaxed)) {
+                        // Read first: once the reader is finished, an empty queue stays empty.
+                        const auto done = finished.load(std::memory_order_acquire);
+                        if (auto batch = queue.TryPop())
+                            batch->ForEach([&stage, &local] (std::string_view record) { stage(record, local); });
+                        else if (done)
+                            break;
+                        else
+                            std::this_thread::yield();
+                    }
+                    result = std::move(local);
+                } catch (...) {
+                    error = std::current_exception();
+                    failed.store(true, std::memory_order_relaxed);
+                }
+            });
+        }
+        // Gives up once a worker has failed, as nothing may be left to empty the queue.
+        const auto push = [&queue, &failed] (RecordBatch& batch) {
+            while (!queue.TryPush(batch)) {
+                if (failed.load(std::memory_order_relaxed))
+                    return false;
+                std::this_thread::yield();
+            }
+            return true;
+        };
+        RecordBatch batch;
+        for (auto record : records) {
+            batch.Add(record);
+            if (batch.Size() >= options.batchRecords) {
+                if (!push(batch))
+                    break;
+                batch = {};
+            }
+        }
+        if (batch.Size() > 0)
+            push(batch);
+    }
+    for (auto& error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+    Result total{};
+    for (auto& result : results)
+        total += result;
+    return total;
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+// Resident server mode: a day loads its input once and then answers queries over a UNIX domain socket until it's
+// killed, so that repeated queries don't each pay for process start and parsing.
+//
+// The protocol is line based. A request is one line of space-separated words, whose meaning is up to the day, and
+// gets exactly one line back: the answer, or "error: " and a reason. A connection can pipeline any number of
+// requests and the answers come back in order. Connections are served by a fixed pool of threads, one connection
+// per thread until it closes, so the day's handler must only read the state it shares between them and clients
+// beyond the pool's size wait for a free thread.
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "common/parse.h"
+
+#if __has_include(<sys/socket.h>) && __has_include(<sys/un.h>)
+#   include <sys/socket.h>
+#   include <sys/un.h>
+#   include <unistd.h>
+#   define AOC_HAVE_UNIX_SOCKETS true
+#else
+#   define AOC_HAVE_UNIX_SOCKETS false
+#endif
+
+#ifndef MSG_NOSIGNAL
+#   define MSG_NOSIGNAL 0
+#endif
+
+using QueryWords = std::vector<std::string_view>;
+using QueryHandler = std::function<std::string(const QueryWords& words)>;
+
+// A request's words as integers, for handlers whose queries are just numbers.
+template <std::integral T, size_t N>
+[[nodiscard]] std::array<T, N> QueryInts(const QueryWords& words, const char* usage) {
+    std::array<T, N> ret{};
+    bool valid = words.size() == N;
+    for (size_t i = 0; valid && i < N; ++i) {
+        const auto value = ToInt<T>(words[i]);
+        valid = value.has_value();
+        ret[i] = value.value_or(0);
+    }
+    if (!valid)
+        throw std::invalid_argument{std::string{"expected "} + usage};
+    return ret;
+}
+
+class QueryServer {
+    static constexpr size_t readSize = 1 << 16;
+
+    QueryHandler handler;
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<int> connections;
+
+    [[nodiscard]] std::string Answer(std::string_view line) const {
+        QueryWords words;
+        while (!line.empty()) {
+            const auto end = std::min(line.find(' '), line.size());
+            if (end > 0)
+                words.push_back(line.substr(0, end));
+            line.remove_prefix(std::min(end + 1, line.size()));
+        }
+        try {
+            return handler(words);
+        } catch (const std::exception& e) {
+            return std::string{"error: "} + e.what();
+        }
+    }
+
+    // Answers every complete line that has arrived, writing the batch back in one go.
+    void Serve(int fd) const {
+#if AOC_HAVE_UNIX_SOCKETS
+        std::string pending, replies;
+        std::vector<char> buffer(readSize);
+        for (ssize_t got; (got = recv(fd, buffer.data(), buffer.size(), 0)) > 0;) {
+            pending.append(buffer.data(), got);
+            size_t start = 0;
+            for (size_t end; (end = pending.find('\n', start)) != std::string::npos; start = end + 1) {
+                auto line = std::string_view{pending}.substr(start, end - start);
+                if (!line.empty() && line.back() == '\r')
+                    line.remove_suffix(1);
+                replies.append(Answer(line)).push_back('\n');
+            }
+            pending.erase(0, start);
+            for (size_t sent = 0; sent < replies.size();) {
+                // A client that hangs up early mustn't take the server down with SIGPIPE.
+                const auto wrote = send(fd, replies.data() + sent, replies.size() - sent, MSG_NOSIGNAL);
+                if (wrote <= 0)
+                    return;
+                sent += wrote;
+            }
+            replies.clear();
+        }
+#endif
+    }
+
+    void Work() {
+        while (true) {
+            int fd;
+            {
+                std::unique_lock lock{mutex};
+                ready.wait(lock, [this] { return !connections.empty(); });
+                fd = connections.front();
+                connections.pop_front();
+            }
+            Serve(fd);
+#if AOC_HAVE_UNIX_SOCKETS
+            close(fd);
+#endif
+        }
+    }
+public:
+    explicit QueryServer(QueryHandler handler) : handler{std::move(handler)} {}
+
+    // Listens on socketPath, replacing any stale socket there, and never returns.
+    [[noreturn]] void Run(const std::string& socketPath, size_t threads = std::thread::hardware_concurrency()) {
+#if AOC_HAVE_UNIX_SOCKETS
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path))
+            throw std::invalid_argument{"Socket path is too long: " + socketPath};
+        std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+        const auto listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(socketPath.c_str());
+        if (listener == -1 || bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 ||
+            listen(listener, SOMAXCONN) != 0)
+            throw std::runtime_error{"Unable to listen on " + socketPath + ": " + std::strerror(errno)};
+        std::vector<std::jthread> workers;
+        for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i)
+            workers.emplace_back([this] { Work(); });
+        while (true) {
+            const auto fd = accept(listener, nullptr, nullptr);
+            if (fd == -1)
+                continue;
+            {
+                std::lock_guard lock{mutex};
+                connections.push_back(fd);
+            }
+            ready.notify_one();
+        }
+#else
+        throw std::runtime_error{"Server mode needs UNIX domain sockets."};
+#endif
+    }
+};
@@ -0,0 +1,206 @@
+#pragma once
+
+// Puzzle input from anywhere, not just a regular file. A path of "-" reads stdin, and pipes, FIFOs and devices are
+// streamed through two fixed-size blocks: a reader thread fills one while the day parses the other, so parsing
+// overlaps with waiting on the writer. Regular files still go through a plain filebuf.
+//
+// A streamed input only moves forwards (skipping ahead is fine, as is tellg). A day that makes more than one pass
+// asks for a rewindable InputStream instead, which spools a streamed input into memory first.
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if __has_include(<unistd.h>) && __has_include(<poll.h>)
+#   include <cerrno>
+#   include <fcntl.h>
+#   include <poll.h>
+#   include <unistd.h>
+#   define AOC_STREAM_INPUT true
+#else
+#   define AOC_STREAM_INPUT false
+#endif
+
+#if AOC_STREAM_INPUT
+class BlockStreamBuf : public std::streambuf {
+    static constexpr size_t blockSize = 1 << 16;
+    static constexpr int stopPollMs = 50;
+
+    int fd;
+    bool ownsFd;
+    std::array<std::vector<char>, 2> blocks{std::vector<char>(blockSize), std::vector<char>(blockSize)};
+    std::array<size_t, 2> filled{};
+    // Blocks are numbered in stream order and block n lives in blocks[n % 2]. The reader may run at most two ahead
+    // of the blocks the parser has finished with.
+    std::mutex mutex;
+    std::condition_variable changed;
+    uint64_t produced = 0;
+    uint64_t consumed = 0;
+    bool finished = false;
+    bool holding = false;
+    uint64_t offset = 0; // Stream position of eback().
+    std::jthread reader;
+
+    // A blocking read, except that it gives up promptly once the parser has gone away.
+    [[nodiscard]] ssize_t Read(char* data, size_t size, std::stop_token stop) const {
+        pollfd ready{fd, POLLIN, 0};
+        while (!stop.stop_requested()) {
+            const auto polled = poll(&ready, 1, stopPollMs);
+            if (polled < 0 && errno != EINTR)
+                return -1;
+            if (polled > 0) {
+                const auto got = read(fd, data, size);
+                if (got >= 0 || errno != EINTR)
+                    return got;
+            }
+        }
+        return 0;
+    }
+
+    void Fill(std::stop_token stop) {
+        for (uint64_t n = 0;; ++n) {
+            {
+                std::unique_lock lock{mutex};
+                changed.wait(lock, [this, n, &stop] { return n - consumed < blocks.size() || stop.stop_requested(); });
+            }
+            auto& block = blocks[n % blocks.size()];
+            const auto got = Read(block.data(), block.size(), stop);
+            {
+                std::lock_guard lock{mutex};
+                if (got <= 0) {
+                    finished = true;
+                } else {
+                    filled[n % blocks.size()] = got;
+                    produced = n + 1;
+                }
+            }
+            changed.notify_one();
+            if (got <= 0)
+                return;
+        }
+    }
+
+    // Hands the current block back to the reader and waits for the next one.
+    [[nodiscard]] bool NextBlock() {
+        std::unique_lock lock{mutex};
+        if (holding) {
+            offset += egptr() - eback();
+            ++consumed;
+            holding = false;
+            changed.notify_one();
+        }
+        changed.wait(lock, [this] { return produced > consumed || finished; });
+        if (produced == consumed) {
+            setg(nullptr, nullptr, nullptr);
+            return false;
+        }
+        auto& block = blocks[consumed % blocks.size()];
+        setg(block.data(), block.data(), block.data() + filled[consumed % blocks.size()]);
+        holding = true;
+        return true;
+    }
+
+    [[nodiscard]] pos_type Position() const noexcept {
+        return static_cast<off_type>(offset + (gptr() - eback()));
+    }
+protected:
+    int_type underflow() override {
+        if (gptr() == egptr() && !NextBlock())
+            return traits_type::eof();
+        return traits_type::to_int_type(*gptr());
+    }
+
+    // Anywhere in the current block, or forwards by any amount.
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+        if (dir != std::ios_base::cur || !(which & std::ios_base::in))
+            return pos_type(off_type(-1));
+        if (off < 0 && -off > gptr() - eback())
+            return pos_type(off_type(-1));
+        while (off > egptr() - gptr()) {
+            off -= egptr() - gptr();
+            setg(eback(), egptr(), egptr());
+            if (!NextBlock())
+                return pos_type(off_type(-1));
+        }
+        gbump(static_cast<int>(off));
+        return Position();
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+        return seekoff(pos - Position(), std::ios_base::cur, which);
+    }
+public:
+    // fd is closed with the buffer if ownsFd.
+    BlockStreamBuf(int fd, bool ownsFd) : fd{fd}, ownsFd{ownsFd}, reader{[this] (std::stop_token stop) {
+        Fill(stop);
+    }} {}
+    BlockStreamBuf(const BlockStreamBuf&) = delete;
+    BlockStreamBuf& operator=(const BlockStreamBuf&) = delete;
+
+    ~BlockStreamBuf() override {
+        {
+            std::lock_guard lock{mutex};
+            reader.request_stop();
+        }
+        changed.notify_all();
+        reader.join();
+        if (ownsFd)
+            close(fd);
+    }
+};
+#endif
+
+// Drop-in for std::ifstream over a day's input path. Like an ifstream, a path that can't be opened leaves the
+// stream failed.
+class InputStream : public std::istream {
+    std::filebuf file;
+    std::stringbuf spool;
+#if AOC_STREAM_INPUT
+    std::unique_ptr<BlockStreamBuf> stream;
+#endif
+
+    // The buffer for anything that isn't a regular file, or nullptr if it can't be opened.
+    [[nodiscard]] std::streambuf* OpenStream(std::string_view path) {
+#if AOC_STREAM_INPUT
+        const auto isStdin = path == "-";
+        const auto fd = isStdin ? STDIN_FILENO : open(std::string{path}.c_str(), O_RDONLY);
+        if (fd == -1)
+            return nullptr;
+        stream = std::make_unique<BlockStreamBuf>(fd, !isStdin);
+        return stream.get();
+#else
+        if (path == "-")
+            return std::cin.rdbuf();
+        return file.open(std::string{path}, std::ios_base::in | std::ios_base::binary) ? &file : nullptr;
+#endif
+    }
+public:
+    // A rewindable stream can seek anywhere, spooling a streamed input into memory if it has to.
+    explicit InputStream(std::string_view path, bool rewindable = false) : std::istream{nullptr} {
+        std::error_code ec;
+        std::streambuf* buffer = nullptr;
+        if (path != "-" && std::filesystem::is_regular_file(path, ec))
+            buffer = file.open(std::string{path}, std::ios_base::in) ? &file : nullptr;
+        else if ((buffer = OpenStream(path)) && rewindable) {
+            std::string contents{std::istreambuf_iterator<char>{buffer}, std::istreambuf_iterator<char>{}};
+            spool.str(std::move(contents));
+            buffer = &spool;
+        }
+        rdbuf(buffer);
+        if (!buffer)
+            setstate(std::ios_base::failbit);
+    }
+};
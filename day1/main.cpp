@@ -1,9 +1,18 @@
-#include <fstream>
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
 #include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#include "common/alloc_profile.h"
+#include "common/parse.h"
+#include "common/serve.h"
+#include "common/stream_input.h"
+
 template <int depth>
 std::optional<int> FindSum(const int target, auto begin, auto end, const int init = 0) {
     for (; begin != end; ++begin) {
@@ -21,16 +30,66 @@ std::optional<int> FindSum(const int target, auto begin, auto end, const int ini
     return std::nullopt;
 }
 
+// The entries sorted once up front, so that a server finds a pair by closing in from both ends in O(n), and a
+// triple by doing that after each entry in O(n^2), rather than trying every combination per query.
+class SortedEntries {
+    std::vector<int> sorted;
+public:
+    explicit SortedEntries(std::vector<int> entries) : sorted{std::move(entries)} {
+        std::ranges::sort(sorted);
+    }
+
+    // The product of two entries from first onwards which sum to target.
+    [[nodiscard]] std::optional<int> FindPair(int target, size_t first = 0) const noexcept {
+        for (auto low = first, high = sorted.size(); low + 1 < high;) {
+            const auto sum = sorted[low] + sorted[high - 1];
+            if (sum == target)
+                return sorted[low] * sorted[high - 1];
+            if (sum < target)
+                ++low;
+            else
+                --high;
+        }
+        return std::nullopt;
+    }
+
+    [[nodiscard]] std::optional<int> FindTriple(int target) const noexcept {
+        for (size_t i = 0; i < sorted.size(); ++i) {
+            if (auto product = FindPair(target - sorted[i], i + 1))
+                return *product * sorted[i];
+        }
+        return std::nullopt;
+    }
+};
+
+// Answers "<2|3> <target>" with the product of that many entries summing to target, or "none".
+[[noreturn]] void Serve(const char* socketPath, const char* input) {
+    InputStream file{input};
+    const SortedEntries entries{ParseInts<int>(ReadAll(file), '\n')};
+    QueryServer{[&entries] (const QueryWords& words) -> std::string {
+        const auto [count, target] = QueryInts<int, 2>(words, "<2|3> <target>");
+        std::optional<int> product;
+        if (count == 2)
+            product = entries.FindPair(target);
+        else if (count == 3)
+            product = entries.FindTriple(target);
+        else
+            throw std::invalid_argument{"can only sum 2 or 3 entries"};
+        return product ? std::to_string(*product) : "none";
+    }}.Run(socketPath);
+}
+
 int main(int argc, const char* argv[]) {
+    if (argc == 4 && std::string_view{argv[1]} == "--serve")
+        Serve(argv[2], argv[3]);
     if (argc != 2)
         return 1;
-    std::string line;
-    std::ifstream file{argv[1]};
-    std::vector<int> queue;
-    while (std::getline(file, line)) {
-        queue.emplace_back(std::stoi(line));
-    }
-    std::cout << *FindSum<1>(2020, queue.cbegin(), queue.cend()) << '\n'
-              << *FindSum<2>(2020, queue.cbegin(), queue.cend()) << '\n';
+    AOC_ALLOC_PHASE("parse");
+    InputStream file{argv[1]};
+    const auto queue = ParseInts<int>(ReadAll(file), '\n');
+    AOC_ALLOC_PHASE("part1");
+    std::cout << *FindSum<1>(2020, queue.cbegin(), queue.cend()) << '\n';
+    AOC_ALLOC_PHASE("part2");
+    std::cout << *FindSum<2>(2020, queue.cbegin(), queue.cend()) << '\n';
     return 0;
 }
@@ -1,8 +1,13 @@
-#include <fstream>
 #include <iostream>
+#include <memory_resource>
 #include <set>
 #include <vector>
 
+#include "common/alloc_profile.h"
+#include "common/arena.h"
+#include "common/parse.h"
+#include "common/stream_input.h"
+
 class Adapter {
     uint16_t rating;
     uint64_t parentPaths;
@@ -34,10 +39,11 @@ class Adapters {
     std::vector<Adapter> adapters;
 public:
     explicit Adapters(std::istream& in) {
-        int16_t rating;
-        std::set<int16_t> data;
+        // Only needed while sorting the ratings; the arena hands it all back when the constructor returns.
+        ParseArena arena{in, 16};
+        std::pmr::set<int16_t> data{&arena};
         adapters.reserve(150);
-        while (in >> rating)
+        for (auto rating : ParseInts<int16_t>(ReadAll(in), '\n'))
             data.emplace(rating);
         adapters.emplace_back(0, 1); // Wall Socket
         for (auto rating : data) {
@@ -72,8 +78,11 @@ public:
 int main(int argc, const char* argv[]) {
     if (argc != 2)
         return 1;
-    std::ifstream file{argv[1]};
+    AOC_ALLOC_PHASE("parse");
+    InputStream file{argv[1]};
     Adapters adapters{file};
+    AOC_ALLOC_PHASE("part1");
     std::cout << adapters.CalculatePart1() << '\n';
+    AOC_ALLOC_PHASE("part2");
     std::cout << adapters.CalculatePart2() << '\n';
 }
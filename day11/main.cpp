@@ -1,9 +1,24 @@
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <bit>
 #include <cstdint>
-#include <fstream>
 #include <iostream>
-#include <unordered_map>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <tuple>
 #include <utility>
+#include <vector>
+
+#include "common/alloc_profile.h"
+#include "common/cpu_dispatch.h"
+#include "common/flat_hash.h"
+#include "common/input_cache.h"
+#include "common/instrument.h"
+#include "common/stream_input.h"
 
 enum class PositionState {
     INVALID,
@@ -12,6 +27,12 @@ enum class PositionState {
     OCCUPIED,
 };
 
+enum class Engine {
+    HASHMAP,
+    BITBOARD,
+    TILED,
+};
+
 class Coord {
     int16_t x;
     int16_t y;
@@ -37,8 +58,229 @@ public:
     };
 };
 
+// One generation of the adjacent-neighbour rule over a row of bitboard words, one bit per cell, returning which
+// bits changed. up, mid and down are the occupied words of the row and those either side of it, and each row has a
+// padding word at index 0 and words + 1 so the shifts across word boundaries need no bounds checks. Every output
+// word depends only on its neighbours' inputs, so the loop vectorises across words for whatever ISA it's built for.
+AOC_KERNEL_INLINE uint64_t StepRowBody(const uint64_t* up, const uint64_t* mid, const uint64_t* down,
+                                       const uint64_t* seat, uint64_t* out, int32_t words) noexcept {
+    constexpr auto top = 63;
+    const auto west = [] (const uint64_t* row, int32_t w) { return (row[w] << 1) | (row[w - 1] >> top); };
+    const auto east = [] (const uint64_t* row, int32_t w) { return (row[w] >> 1) | (row[w + 1] << top); };
+    const auto fullAdd = [] (uint64_t a, uint64_t b, uint64_t c, uint64_t& sum, uint64_t& carry) {
+        const auto ab = a ^ b;
+        sum = ab ^ c;
+        carry = (a & b) | (ab & c);
+    };
+    uint64_t diff = 0;
+    for (auto w = 1; w <= words; ++w) {
+        const uint64_t n[8] = {up[w], west(up, w), east(up, w), west(mid, w),
+                               east(mid, w), down[w], west(down, w), east(down, w)};
+        // Bit-sliced adder network: ones/twos are the low bits of the count, fours/eights only matter as
+        // "at least four", so they're never resolved into separate planes.
+        uint64_t s0, c0, s1, c1, ones, c2, t, c3;
+        fullAdd(n[0], n[1], n[2], s0, c0);
+        fullAdd(n[3], n[4], n[5], s1, c1);
+        fullAdd(s0, s1, n[6] ^ n[7], ones, c2);
+        fullAdd(c0, c1, n[6] & n[7], t, c3);
+        const auto twos = t ^ c2;
+        const auto c4 = t & c2;
+        const auto none = ~(ones | twos | c3 | c4);
+        const auto crowded = c3 | c4;
+        const auto cur = mid[w];
+        out[w] = (seat[w] & ~cur & none) | (cur & ~crowded);
+        diff |= out[w] ^ cur;
+    }
+    return diff;
+}
+
+uint64_t StepRowScalar(const uint64_t* up, const uint64_t* mid, const uint64_t* down, const uint64_t* seat,
+                       uint64_t* out, int32_t words) noexcept {
+    return StepRowBody(up, mid, down, seat, out, words);
+}
+
+AOC_TARGET_SSE42 uint64_t StepRowSse42(const uint64_t* up, const uint64_t* mid, const uint64_t* down,
+                                       const uint64_t* seat, uint64_t* out, int32_t words) noexcept {
+    return StepRowBody(up, mid, down, seat, out, words);
+}
+
+AOC_TARGET_AVX2 uint64_t StepRowAvx2(const uint64_t* up, const uint64_t* mid, const uint64_t* down,
+                                     const uint64_t* seat, uint64_t* out, int32_t words) noexcept {
+    return StepRowBody(up, mid, down, seat, out, words);
+}
+
+AOC_TARGET_AVX512 uint64_t StepRowAvx512(const uint64_t* up, const uint64_t* mid, const uint64_t* down,
+                                         const uint64_t* seat, uint64_t* out, int32_t words) noexcept {
+    return StepRowBody(up, mid, down, seat, out, words);
+}
+
+uint64_t StepRow(const uint64_t* up, const uint64_t* mid, const uint64_t* down, const uint64_t* seat, uint64_t* out,
+                 int32_t words) {
+    static auto* const kernel = KernelVariants<decltype(StepRowScalar)>{
+        StepRowScalar, StepRowSse42, StepRowAvx2, StepRowAvx512}.Select();
+    return kernel(up, mid, down, seat, out, words);
+}
+
+// Packs the room into bit-planes, one bit per cell, so the adjacent-neighbour rule can be evaluated for a whole
+// word of cells at once. Every row is padded with a zero word on either side and the board with a zero row above
+// and below, which lets the kernel read neighbouring words and rows without any bounds checks.
+class SeatBitboard {
+    using Word = uint64_t;
+    static constexpr int32_t wordBits = sizeof(Word) * 8;
+
+    int32_t words;
+    int32_t stride;
+    int32_t rows;
+    std::vector<Word> seats;
+    std::vector<Word> occupied;
+    std::vector<Word> next;
+
+    [[nodiscard]] bool Step() {
+        Word diff = 0;
+        for (auto row = 1; row <= rows; ++row) {
+            diff |= StepRow(&occupied[(row - 1) * stride], &occupied[row * stride], &occupied[(row + 1) * stride],
+                            &seats[row * stride], &next[row * stride], words);
+        }
+        std::swap(occupied, next);
+        return diff != 0;
+    }
+public:
+    SeatBitboard(int32_t width, int32_t height) :
+        words{(width + wordBits - 1) / wordBits}, stride{words + 2}, rows{height},
+        seats(static_cast<size_t>(stride) * (rows + 2)), occupied(seats.size()), next(seats.size()) {}
+
+    void AddSeat(int32_t x, int32_t y) noexcept {
+        seats[(y + 1) * stride + 1 + x / wordBits] |= Word{1} << (x % wordBits);
+    }
+
+    [[nodiscard]] int32_t Settle() {
+        AOC_TIME_SCOPE("day11.SeatBitboard.Settle");
+        std::ranges::fill(occupied, 0);
+        while (Step())
+            AOC_COUNT("day11.SeatBitboard.generations");
+        auto count = 0;
+        for (auto w : occupied)
+            count += std::popcount(w);
+        return count;
+    }
+};
+
+// Multithreaded engine for either rule. Seats are grouped into square tiles which each own a contiguous range of
+// seats; a generation only evaluates tiles that watch a seat which changed in the previous generation, and the room
+// has settled once no tile is left active.
+class TiledSimulation {
+public:
+    using Watches = std::array<int32_t, 8>;
+    static constexpr int16_t tileSize = 64; // 4096 seats of state and watch lists stay resident in L2
+    static constexpr int32_t noSeat = -1;
+private:
+    struct Tile {
+        int32_t begin;
+        int32_t end;
+        std::vector<int32_t> dependents;
+        bool changed = false;
+    };
+
+    std::vector<Watches> watches;
+    std::vector<uint8_t> occupied;
+    std::vector<uint8_t> next;
+    std::vector<Tile> tiles;
+    std::vector<int32_t> active;
+    std::unique_ptr<std::atomic<bool>[]> pending;
+    std::atomic<size_t> cursor = 0;
+    bool committing = false;
+    bool settled = false;
+    int8_t crowdedAt;
+
+    void Evaluate(Tile& tile) noexcept {
+        tile.changed = false;
+        for (auto i = tile.begin; i != tile.end; ++i) {
+            auto count = 0;
+            for (auto seat : watches[i])
+                count += seat != noSeat && occupied[seat];
+            next[i] = occupied[i] ? count < crowdedAt : count == 0;
+            tile.changed |= next[i] != occupied[i];
+        }
+    }
+
+    void Commit(Tile& tile) noexcept {
+        if (!tile.changed)
+            return;
+        std::copy(next.begin() + tile.begin, next.begin() + tile.end, occupied.begin() + tile.begin);
+        for (auto dependent : tile.dependents)
+            pending[dependent].store(true, std::memory_order_relaxed);
+    }
+
+    void NextPhase() noexcept {
+        cursor = 0;
+        committing = !committing;
+        if (committing)
+            return;
+        active.clear();
+        for (int32_t i = 0; i < static_cast<int32_t>(tiles.size()); ++i) {
+            if (pending[i].exchange(false, std::memory_order_relaxed))
+                active.push_back(i);
+        }
+        settled = active.empty();
+        AOC_COUNT("day11.TiledSimulation.generations");
+        AOC_HISTOGRAM("day11.TiledSimulation.activeTiles", active.size());
+    }
+
+    template <class Barrier>
+    void Work(Barrier& sync) noexcept {
+        while (!settled) {
+            for (auto i = cursor++; i < active.size(); i = cursor++)
+                committing ? Commit(tiles[active[i]]) : Evaluate(tiles[active[i]]);
+            sync.arrive_and_wait();
+        }
+    }
+public:
+    // tileOfSeat must be sorted, i.e. seats are already grouped by tile.
+    TiledSimulation(std::vector<Watches> watches, const std::vector<int32_t>& tileOfSeat, int8_t crowdedAt) :
+        watches{std::move(watches)}, occupied(this->watches.size()), next(occupied.size()), crowdedAt{crowdedAt} {
+        std::vector<int32_t> tileIndex(tileOfSeat.size());
+        for (int32_t i = 0; i < static_cast<int32_t>(tileOfSeat.size()); ++i) {
+            if (i == 0 || tileOfSeat[i] != tileOfSeat[i - 1])
+                tiles.push_back({i, i, {}, false});
+            ++tiles.back().end;
+            tileIndex[i] = tiles.size() - 1;
+        }
+        for (size_t i = 0; i < this->watches.size(); ++i) {
+            for (auto seat : this->watches[i]) {
+                if (seat != noSeat)
+                    tiles[tileIndex[seat]].dependents.push_back(tileIndex[i]);
+            }
+        }
+        for (auto& tile : tiles) {
+            std::ranges::sort(tile.dependents);
+            tile.dependents.erase(std::unique(tile.dependents.begin(), tile.dependents.end()), tile.dependents.end());
+        }
+        pending = std::make_unique<std::atomic<bool>[]>(tiles.size());
+        active.reserve(tiles.size());
+    }
+
+    [[nodiscard]] int32_t Settle() {
+        AOC_TIME_SCOPE("day11.TiledSimulation.Settle");
+        std::ranges::fill(occupied, 0);
+        active.clear();
+        for (int32_t i = 0; i < static_cast<int32_t>(tiles.size()); ++i)
+            active.push_back(i);
+        committing = false;
+        settled = active.empty();
+        const auto threads = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, std::max<size_t>(tiles.size(), 1));
+        std::barrier sync{static_cast<std::ptrdiff_t>(threads), [this] () noexcept { NextPhase(); }};
+        {
+            std::vector<std::jthread> workers;
+            for (size_t i = 1; i < threads; ++i)
+                workers.emplace_back([this, &sync] { Work(sync); });
+            Work(sync);
+        }
+        return std::ranges::count(occupied, 1);
+    }
+};
+
 class SpaceArrangement {
-    std::unordered_map<Coord, PositionState, Coord::Hash> positions;
+    FlatHashMap<Coord, PositionState, Coord::Hash> positions;
     int16_t xMax;
     int16_t yMax;
 
@@ -58,19 +300,22 @@ class SpaceArrangement {
         return positions.end();
     }
 
+    [[nodiscard]] std::array<std::tuple<int16_t, int16_t, int16_t, int16_t>, 8> Rays() const noexcept {
+        return {{{0, -1, -1, 0}, // up
+                 {0, 1, -1, yMax}, // down
+                 {-1, 0, 0, -1}, // left
+                 {1, 0, xMax, -1}, // right
+                 {-1, -1, 0, 0}, // up&left
+                 {1, -1, xMax, 0}, // up&right
+                 {-1, 1, 0, yMax}, // down&left
+                 {1, 1, xMax, yMax}, // down&right
+                 }};
+    }
+
     template <class Predicate>
     [[nodiscard]] bool CountRaycastsInState(int16_t x, int16_t y, int8_t target, Predicate&& pred) const noexcept {
         auto count = 0;
-        std::initializer_list<std::tuple<int16_t, int16_t, int16_t, int16_t>> consider = {{0, -1, -1, 0}, // up
-                                                                                          {0, 1, -1, yMax}, // down
-                                                                                          {-1, 0, 0, -1}, // left
-                                                                                          {1, 0, xMax, -1}, // right
-                                                                                          {-1, -1, 0, 0}, // up&left
-                                                                                          {1, -1, xMax, 0}, // up&right
-                                                                                          {-1, 1, 0, yMax}, // down&left
-                                                                                          {1, 1, xMax, yMax}, // down&right
-                                                                                          };
-        for (auto& [xdt, ydt, xLim, yLim] : consider) {
+        for (auto& [xdt, ydt, xLim, yLim] : Rays()) {
             auto pos = RaycastToChair(x, y, xdt, ydt, xLim, yLim);
             count += pred(pos == positions.end() ? PositionState::INVALID : pos->second) ? 1 : 0;
             if (count == target)
@@ -118,6 +363,8 @@ class SpaceArrangement {
     }
     
     [[nodiscard]] std::pair<decltype(positions), bool> Simulate(bool raycast) {
+        AOC_TIME_SCOPE("day11.Simulate");
+        AOC_COUNT("day11.Simulate.generations");
         auto newPositions = positions;
         auto changed = false;
         for (auto& kvp : positions) {
@@ -125,14 +372,57 @@ class SpaceArrangement {
             if (ShouldBecomeOccupied(kvp, raycast)) {
                 newPositions[coord] = PositionState::OCCUPIED;
                 changed = true;
+                AOC_COUNT("day11.Simulate.seatChanges");
             }
             else if (ShouldBecomeEmpty(kvp, raycast, raycast ? 5 : 4)) {
                 newPositions[coord] = PositionState::AVAILABLE;
                 changed = true;
+                AOC_COUNT("day11.Simulate.seatChanges");
             }
         }
         return {std::move(newPositions), changed};
     }
+
+    [[nodiscard]] SeatBitboard ToBitboard() const {
+        SeatBitboard board{xMax + 1, yMax + 1};
+        for (auto& [coord, state] : positions)
+            board.AddSeat(coord.X(), coord.Y());
+        return board;
+    }
+
+    [[nodiscard]] TiledSimulation ToTiled(bool raycast) const {
+        constexpr auto tileSize = TiledSimulation::tileSize;
+        const auto tilesPerRow = xMax / tileSize + 1;
+        const auto tileOf = [tilesPerRow] (const Coord& coord) {
+            return (coord.Y() / tileSize) * tilesPerRow + coord.X() / tileSize;
+        };
+        std::vector<Coord> seats;
+        seats.reserve(positions.size());
+        for (auto& [coord, state] : positions)
+            seats.push_back(coord);
+        std::ranges::sort(seats, [&tileOf] (auto& a, auto& b) {
+            return std::tuple{tileOf(a), a.Y(), a.X()} < std::tuple{tileOf(b), b.Y(), b.X()};
+        });
+        FlatHashMap<Coord, int32_t, Coord::Hash> index{seats.size()};
+        std::vector<int32_t> tileOfSeat;
+        tileOfSeat.reserve(seats.size());
+        for (int32_t i = 0; i < static_cast<int32_t>(seats.size()); ++i) {
+            index.emplace(seats[i], i);
+            tileOfSeat.push_back(tileOf(seats[i]));
+        }
+        std::vector<TiledSimulation::Watches> watches(seats.size());
+        for (size_t i = 0; i < seats.size(); ++i) {
+            auto x = seats[i].X(), y = seats[i].Y();
+            auto rays = Rays();
+            for (size_t r = 0; r < rays.size(); ++r) {
+                auto& [xdt, ydt, xLim, yLim] = rays[r];
+                auto pos = raycast ? RaycastToChair(x, y, xdt, ydt, xLim, yLim) :
+                                     positions.find(Coord(x + xdt, y + ydt));
+                watches[i][r] = pos == positions.end() ? TiledSimulation::noSeat : index.find(pos->first)->second;
+            }
+        }
+        return {std::move(watches), tileOfSeat, static_cast<int8_t>(raycast ? 5 : 4)};
+    }
 public:
     explicit SpaceArrangement(std::istream& in) {
         char c;
@@ -149,7 +439,31 @@ public:
         xMax = x - 1;
     }
 
-    [[nodiscard]] int16_t SolvePart(bool isPart1) {
+    explicit SpaceArrangement(CacheReader& cache) : xMax{cache.Read<int16_t>()}, yMax{cache.Read<int16_t>()} {
+        auto seats = cache.ReadSpan<Coord>();
+        positions.reserve(seats.size());
+        for (auto& seat : seats)
+            positions.emplace(seat, PositionState::AVAILABLE);
+    }
+
+    void Save(CacheWriter& cache) const {
+        std::vector<Coord> seats;
+        seats.reserve(positions.size());
+        for (auto& [coord, state] : positions)
+            seats.push_back(coord);
+        cache.Write(xMax);
+        cache.Write(yMax);
+        cache.WriteSpan(std::span<const Coord>{seats});
+    }
+
+    [[nodiscard]] int32_t SolvePart(bool isPart1, Engine engine = Engine::HASHMAP) {
+        if (engine == Engine::BITBOARD) {
+            if (isPart1)
+                throw std::invalid_argument{"The bitboard engine only implements the adjacent-neighbour rule."};
+            return ToBitboard().Settle();
+        }
+        if (engine == Engine::TILED)
+            return ToTiled(isPart1).Settle();
         auto savedState = positions;
         while (true) {
             auto&& [newPos, changed] = Simulate(isPart1);
@@ -166,8 +480,18 @@ public:
 int main(int argc, const char* argv[]) {
     if (argc != 2)
         return 1;
-    std::ifstream file{argv[1]};
-    SpaceArrangement arrangement{file};
-    std::cout << arrangement.SolvePart(false) << '\n';
-    std::cout << arrangement.SolvePart(true) << '\n';
+    AOC_ALLOC_PHASE("parse");
+    InputCache cache{argv[1], "day11", 1};
+    auto cached = cache.Open();
+    // The input itself is only opened on a miss.
+    SpaceArrangement arrangement = cached ? SpaceArrangement{*cached} : [input = argv[1]] {
+        InputStream file{input};
+        return SpaceArrangement{file};
+    }();
+    if (!cached)
+        cache.Store(arrangement);
+    AOC_ALLOC_PHASE("part1");
+    std::cout << arrangement.SolvePart(false, Engine::BITBOARD) << '\n';
+    AOC_ALLOC_PHASE("part2");
+    std::cout << arrangement.SolvePart(true, Engine::TILED) << '\n';
 }
\ No newline at end of file
@@ -1,121 +1,289 @@
-#include <cmath>
+#include <algorithm>
 #include <cstdint>
-#include <fstream>
+#include <future>
 #include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
 
-class Movable {
-    int16_t dir = 90;
-    int32_t x = 0;
-    int32_t y = 0;
-    static const inline double radian = std::acos(-1) / 180.;
-public:
-    Movable(int32_t x, int32_t y) noexcept : x{x}, y{y} {}
+#include "common/alloc_profile.h"
+#include "common/parse.h"
+#include "common/stream_input.h"
+
+struct Instruction {
+    char cmd;
+    int16_t num;
+};
+
+using Program = std::vector<Instruction>;
+
+[[nodiscard]] Program ParseProgram(std::istream& in) {
+    Program program;
+    std::string line;
+    while (std::getline(in, line)) {
+        int16_t num;
+        if (!line.empty() && ParseInt(line.data() + 1, line.data() + line.size(), num).ec == std::errc{})
+            program.push_back({line[0], num});
+    }
+    return program;
+}
+
+struct Vector {
+    int64_t x = 0;
+    int64_t y = 0;
+
+    [[nodiscard]] constexpr Vector operator+(const Vector& rhs) const noexcept {
+        return {x + rhs.x, y + rhs.y};
+    }
 
-    constexpr void Go(int32_t num, int32_t d) noexcept {
-        if (d == 0)
-            y -= num;
-        else if (d == 180)
-            y += num;
-        else if (d == 90)
-            x += num;
-        else if (d == 270)
-            x -= num;
+    [[nodiscard]] constexpr Vector operator-(const Vector& rhs) const noexcept {
+        return {x - rhs.x, y - rhs.y};
     }
+};
 
-    constexpr void Turn(int32_t num) noexcept {
-        dir = (dir + num) % 360;
-        if (dir < 0)
-            dir += 360;
+struct Matrix {
+    int64_t xx = 0, xy = 0;
+    int64_t yx = 0, yy = 0;
+
+    [[nodiscard]] static constexpr Matrix Scale(int64_t n) noexcept {
+        return {n, 0, 0, n};
     }
 
-    void TurnRelativeTo(Movable& ship, int32_t degrees) {
-        auto sin = static_cast<int>(std::sin(radian * degrees));
-        auto cos = static_cast<int>(std::cos(radian * degrees));
-        auto newX = x - ship.x;
-        auto newY = y - ship.y;
-        x = ((newX * cos) - (newY * sin)) + ship.x;
-        y = ((newX * sin) + (newY * cos)) + ship.y;
+    // Clockwise, given that north is -y.
+    [[nodiscard]] static constexpr Matrix Rotate(int32_t degrees) noexcept {
+        switch (((degrees / 90) % 4 + 4) % 4) {
+            case 1:
+                return {0, -1, 1, 0};
+            case 2:
+                return {-1, 0, 0, -1};
+            case 3:
+                return {0, 1, -1, 0};
+            default:
+                return Scale(1);
+        }
     }
 
-    constexpr void TravelTo(Movable& waypoint, int32_t times) noexcept {
-        auto xDt = (waypoint.x - x) * times;
-        auto yDt = (waypoint.y - y) * times;
-        x += xDt;
-        y += yDt;
-        waypoint.x += xDt;
-        waypoint.y += yDt;
+    [[nodiscard]] constexpr Matrix operator+(const Matrix& rhs) const noexcept {
+        return {xx + rhs.xx, xy + rhs.xy, yx + rhs.yx, yy + rhs.yy};
     }
 
-    [[nodiscard]] int32_t Dir() const noexcept {
-        return dir;
+    [[nodiscard]] constexpr Matrix operator*(const Matrix& rhs) const noexcept {
+        return {xx * rhs.xx + xy * rhs.yx, xx * rhs.xy + xy * rhs.yy,
+                yx * rhs.xx + yy * rhs.yx, yx * rhs.xy + yy * rhs.yy};
     }
 
-    [[nodiscard]] int32_t X() const noexcept {
+    [[nodiscard]] constexpr Vector operator*(const Vector& rhs) const noexcept {
+        return {xx * rhs.x + xy * rhs.y, yx * rhs.x + yy * rhs.y};
+    }
+};
+
+class Movable {
+    int64_t x = 0;
+    int64_t y = 0;
+public:
+    Movable(int64_t x, int64_t y) noexcept : x{x}, y{y} {}
+
+    [[nodiscard]] int64_t X() const noexcept {
         return x;
     }
 
-    [[nodiscard]] int32_t Y() const noexcept {
+    [[nodiscard]] int64_t Y() const noexcept {
         return y;
     }
 
-    [[nodiscard]] int32_t DistanceFromOrigin() const noexcept {
+    [[nodiscard]] Vector Position() const noexcept {
+        return {x, y};
+    }
+
+    void MoveTo(Vector pos) noexcept {
+        x = pos.x;
+        y = pos.y;
+    }
+
+    [[nodiscard]] int64_t DistanceFromOrigin() const noexcept {
         return std::abs(x) + std::abs(y);
     }
 };
 
-void SolvePart1(Movable& ship, std::istream& in) {
-    char cmd;
-    int16_t num;
-    while (in >> cmd >> num) {
-        if (cmd == 'F')
-            ship.Go(num, ship.Dir());
-        else if (cmd == 'N')
-            ship.Go(num, 0);
+// An instruction, or a run of them, as an affine map over the ship and a waypoint held relative to it:
+//   ship' = ship + travel * waypoint + shipOffset
+//   waypoint' = rotate * waypoint + waypointOffset
+// Part 1's heading is simply a waypoint one unit away which never gets moved. Composition is associative, so a
+// program can be folded in chunks and the chunks combined in order.
+class Transform {
+    Matrix rotate = Matrix::Scale(1);
+    Matrix travel;
+    Vector shipOffset;
+    Vector waypointOffset;
+
+    [[nodiscard]] static constexpr Vector Heading(char cmd, int64_t num) noexcept {
+        if (cmd == 'N')
+            return {0, -num};
         else if (cmd == 'S')
-            ship.Go(num, 180);
+            return {0, num};
         else if (cmd == 'E')
-            ship.Go(num, 90);
+            return {num, 0};
         else if (cmd == 'W')
-            ship.Go(num, 270);
-        else if (cmd == 'R')
-            ship.Turn(num);
-        else if (cmd == 'L')
-            ship.Turn(-num);
+            return {-num, 0};
+        return {};
+    }
+public:
+    constexpr Transform() noexcept = default;
+
+    constexpr Transform(Instruction insn, bool moveWaypoint) noexcept {
+        if (insn.cmd == 'F')
+            travel = Matrix::Scale(insn.num);
+        else if (insn.cmd == 'R')
+            rotate = Matrix::Rotate(insn.num);
+        else if (insn.cmd == 'L')
+            rotate = Matrix::Rotate(-insn.num);
+        else
+            (moveWaypoint ? waypointOffset : shipOffset) = Heading(insn.cmd, insn.num);
     }
+
+    [[nodiscard]] constexpr Transform Then(const Transform& next) const noexcept {
+        Transform ret;
+        ret.rotate = next.rotate * rotate;
+        ret.travel = travel + next.travel * rotate;
+        ret.shipOffset = shipOffset + next.travel * waypointOffset + next.shipOffset;
+        ret.waypointOffset = next.rotate * waypointOffset + next.waypointOffset;
+        return ret;
+    }
+
+    void Apply(Movable& ship, Movable& waypoint) const noexcept {
+        auto relative = waypoint.Position() - ship.Position();
+        ship.MoveTo(ship.Position() + travel * relative + shipOffset);
+        waypoint.MoveTo(ship.Position() + rotate * relative + waypointOffset);
+    }
+};
+
+[[nodiscard]] Transform Compile(const Program& program, bool moveWaypoint) {
+    constexpr size_t minChunk = 1 << 16;
+    const auto threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+    const auto chunk = std::max(minChunk, (program.size() + threads - 1) / threads);
+    std::vector<std::future<Transform>> partials;
+    for (size_t begin = 0; begin < program.size(); begin += chunk) {
+        const auto end = std::min(begin + chunk, program.size());
+        partials.push_back(std::async(std::launch::async, [&program, begin, end, moveWaypoint] {
+            Transform ret;
+            for (auto i = begin; i != end; ++i)
+                ret = ret.Then(Transform{program[i], moveWaypoint});
+            return ret;
+        }));
+    }
+    Transform ret;
+    for (auto& partial : partials)
+        ret = ret.Then(partial.get());
+    return ret;
 }
 
-void SolvePart2(Movable& ship, Movable& waypoint, std::istream& in) {
-    char cmd;
-    int16_t num;
-    while (in >> cmd >> num) {
-        if (cmd == 'F')
-            ship.TravelTo(waypoint, num);
-        else if (cmd == 'N')
-            waypoint.Go(num, 0);
-        else if (cmd == 'S')
-            waypoint.Go(num, 180);
-        else if (cmd == 'E')
-            waypoint.Go(num, 90);
-        else if (cmd == 'W')
-            waypoint.Go(num, 270);
-        else if (cmd == 'R')
-            waypoint.TurnRelativeTo(ship, num);
-        else if (cmd == 'L')
-            waypoint.TurnRelativeTo(ship, -num);
+void SolvePart1(Movable& ship, const Program& program) {
+    Movable heading{ship.X() + 1, ship.Y()};
+    Compile(program, false).Apply(ship, heading);
+}
+
+void SolvePart2(Movable& ship, Movable& waypoint, const Program& program) {
+    Compile(program, true).Apply(ship, waypoint);
+}
+
+// Runs many independent routes side by side. Ship and waypoint coordinates are kept as structure-of-arrays and the
+// programs are transposed so that step n of every route is contiguous; shorter routes are padded with a command
+// that does nothing. Each step is branch-free per ship, selecting the outcome of every command with masks, which
+// lets the compiler run the ships across SIMD lanes.
+class Fleet {
+    size_t ships;
+    size_t steps = 0;
+    std::vector<char> cmds;
+    std::vector<int16_t> nums;
+    std::vector<int64_t> shipX, shipY;
+    std::vector<int64_t> wayX, wayY; // relative to the ship, 64-bit like the single route's Movable
+
+    void Step(size_t step, int64_t moveWaypoint) noexcept {
+        const auto* cmd = &cmds[step * ships];
+        const auto* num = &nums[step * ships];
+        for (size_t i = 0; i < ships; ++i) {
+            const int64_t c = cmd[i], n = num[i];
+            const auto mx = n * ((c == 'E') - (c == 'W'));
+            const auto my = n * ((c == 'S') - (c == 'N'));
+            const auto forward = n & -(c == 'F');
+            const auto quarter = ((n & -(c == 'R')) - (n & -(c == 'L'))) / 90 & 3;
+            const int64_t q0 = -(quarter == 0), q1 = -(quarter == 1), q2 = -(quarter == 2), q3 = -(quarter == 3);
+            const auto wx = wayX[i], wy = wayY[i];
+            shipX[i] += forward * wx + (mx & ~moveWaypoint);
+            shipY[i] += forward * wy + (my & ~moveWaypoint);
+            wayX[i] = ((wx & q0) | (-wy & q1) | (-wx & q2) | (wy & q3)) + (mx & moveWaypoint);
+            wayY[i] = ((wy & q0) | (wx & q1) | (-wy & q2) | (-wx & q3)) + (my & moveWaypoint);
+        }
+    }
+public:
+    explicit Fleet(const std::vector<Program>& programs) : ships{programs.size()},
+        shipX(ships), shipY(ships), wayX(ships), wayY(ships) {
+        for (auto& program : programs)
+            steps = std::max(steps, program.size());
+        cmds.resize(steps * ships);
+        nums.resize(steps * ships);
+        for (size_t ship = 0; ship < ships; ++ship) {
+            for (size_t step = 0; step < programs[ship].size(); ++step) {
+                cmds[step * ships + ship] = programs[ship][step].cmd;
+                nums[step * ships + ship] = programs[ship][step].num;
+            }
+        }
+    }
+
+    // Same semantics as SolvePart1 (moveWaypoint == false, waypoint is the heading) and SolvePart2.
+    void Run(bool moveWaypoint, Vector waypoint) noexcept {
+        std::ranges::fill(shipX, 0);
+        std::ranges::fill(shipY, 0);
+        std::ranges::fill(wayX, waypoint.x);
+        std::ranges::fill(wayY, waypoint.y);
+        for (size_t step = 0; step < steps; ++step)
+            Step(step, -static_cast<int64_t>(moveWaypoint));
+    }
+
+    [[nodiscard]] size_t Ships() const noexcept {
+        return ships;
     }
+
+    [[nodiscard]] int64_t DistanceFromOrigin(size_t ship) const noexcept {
+        return Movable{shipX[ship], shipY[ship]}.DistanceFromOrigin();
+    }
+};
+
+void SolveFleet(int argc, const char* argv[]) {
+    std::vector<Program> programs;
+    for (auto i = 1; i < argc; ++i) {
+        InputStream file{argv[i]};
+        programs.push_back(ParseProgram(file));
+    }
+    Fleet fleet{programs};
+    std::vector<int64_t> part1;
+    fleet.Run(false, {1, 0});
+    for (size_t i = 0; i < fleet.Ships(); ++i)
+        part1.push_back(fleet.DistanceFromOrigin(i));
+    fleet.Run(true, {10, -1});
+    for (size_t i = 0; i < fleet.Ships(); ++i)
+        std::cout << part1[i] << '\n' << fleet.DistanceFromOrigin(i) << '\n';
 }
 
 int main(int argc, const char* argv[]) {
-    if (argc != 2)
+    if (argc < 2)
         return 1;
-    std::ifstream file{argv[1]};
+    if (argc > 2) {
+        AOC_ALLOC_PHASE("fleet");
+        SolveFleet(argc, argv);
+        return 0;
+    }
+    AOC_ALLOC_PHASE("parse");
+    InputStream file{argv[1]};
+    const auto program = ParseProgram(file);
+    AOC_ALLOC_PHASE("solve"); // the parts run concurrently
+    auto part1 = std::async(std::launch::async, [&program] {
+        Movable ship{0, 0};
+        SolvePart1(ship, program);
+        return ship.DistanceFromOrigin();
+    });
     Movable ship{0, 0};
-    SolvePart1(ship, file);
-    std::cout << ship.DistanceFromOrigin() << '\n';
-    file.clear();
-    file.seekg(0);
-    ship = Movable{0, 0};
     Movable waypoint{10, -1};
-    SolvePart2(ship, waypoint, file);
-    std::cout << ship.DistanceFromOrigin() << '\n';
-}
\ No newline at end of file
+    SolvePart2(ship, waypoint, program);
+    std::cout << part1.get() << '\n' << ship.DistanceFromOrigin() << '\n';
+}
@@ -1,9 +1,16 @@
 #include <algorithm>
-#include <fstream>
+#include <cstdint>
 #include <iostream>
-#include <numeric>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "common/alloc_profile.h"
+#include "common/parse.h"
+#include "common/stream_input.h"
+
 class Bus {
     int64_t id;
     int64_t offset;
@@ -37,29 +44,58 @@ public:
 class Buses {
     std::vector<Bus> buses;
     int64_t timestamp;
-    int64_t mult = 1;
 
-    static int64_t FindModMult(int64_t val, int64_t id) {
-        int i;
-        for (i = 1; ((val * i) % id) != 1; ++i);
-        return i;
+    [[nodiscard]] static constexpr int64_t Mod(int64_t val, int64_t mod) noexcept {
+        auto ret = val % mod;
+        return ret < 0 ? ret + mod : ret;
+    }
+
+    // a * b % mod without overflow, for a and b already reduced.
+    [[nodiscard]] static constexpr int64_t MulMod(int64_t a, int64_t b, int64_t mod) noexcept {
+#ifdef __SIZEOF_INT128__
+        return static_cast<int64_t>(static_cast<__int128>(a) * b % mod);
+#else
+        int64_t ret = 0;
+        for (; b > 0; b >>= 1) {
+            if (b & 1)
+                ret = ret >= mod - a ? ret - (mod - a) : ret + a;
+            a = a >= mod - a ? a - (mod - a) : a + a;
+        }
+        return ret;
+#endif
+    }
+
+    // Returns {gcd(a, b), x} such that a * x is congruent to gcd(a, b) modulo b.
+    [[nodiscard]] static constexpr std::pair<int64_t, int64_t> ExtendedEuclid(int64_t a, int64_t b) noexcept {
+        int64_t oldR = a, r = b, oldX = 1, x = 0;
+        while (r != 0) {
+            auto q = oldR / r;
+            oldR = std::exchange(r, oldR - q * r);
+            oldX = std::exchange(x, oldX - q * x);
+        }
+        return {oldR, oldX};
+    }
+
+    // Folds "t is congruent to residue modulo modulus" into the running solution t mod mod. The moduli don't need
+    // to be coprime, but their residues must then agree.
+    static void MergeCongruence(int64_t& t, int64_t& mod, int64_t residue, int64_t modulus) {
+        auto [gcd, inverse] = ExtendedEuclid(mod, modulus);
+        auto diff = residue - t;
+        if (diff % gcd != 0)
+            throw std::runtime_error{"No timestamp satisfies every bus."};
+        auto step = modulus / gcd;
+        if (mod > std::numeric_limits<int64_t>::max() / step)
+            throw std::overflow_error{"The bus schedule period does not fit in 64 bits."};
+        t += mod * MulMod(Mod(diff / gcd, step), Mod(inverse, step), step);
+        mod *= step;
     }
 public:
     explicit Buses(std::istream& in) {
-        in >> timestamp;
-        int busId, i = 0;
-        while (!in.eof()) {
-            in >> busId;
-            if (in) {
-                in.ignore(1);
-                mult *= busId;
-                buses.emplace_back(busId, i++, timestamp);
-            } else {
-                in.clear();
-                in.ignore(2);
-                ++i;
-            }
-        }
+        std::string line;
+        std::getline(in, line);
+        timestamp = ToInt<int64_t>(line).value_or(0);
+        std::getline(in, line);
+        ForEachInt<int>(line, ',', [this] (size_t i, int busId) { buses.emplace_back(busId, i, timestamp); });
     }
 
     [[nodiscard]] int64_t SolvePart1() const noexcept {
@@ -67,29 +103,23 @@ public:
         return bus->WaitTime() * bus->ID();
     }
 
-    [[nodiscard]] int64_t SolvePart2() const noexcept {
-        std::vector<int64_t> reciprocals;
-        std::vector<int64_t> modOneMult;
-        reciprocals.reserve(buses.size()), modOneMult.reserve(buses.size());
+    [[nodiscard]] int64_t SolvePart2() const {
+        int64_t result = 0, mod = 1;
         for (auto& bus : buses)
-            reciprocals.emplace_back(mult / bus.ID());
-        for (auto i = 0; i < buses.size(); ++i)
-            modOneMult.emplace_back(FindModMult(reciprocals[i], buses[i].ID()));
-        int64_t result = 0;
-        for (auto i = 0; i < buses.size(); ++i) {
-            auto tgtMod = (buses[i].ID() - buses[i].Offset()) % buses[i].ID();
-            result += (tgtMod * reciprocals[i] * modOneMult[i]);
-        }
-        return result % mult;
+            MergeCongruence(result, mod, Mod(-bus.Offset(), bus.ID()), bus.ID());
+        return result;
     }
 };
 
 int main(int argc, const char* argv[]) {
     if (argc != 2)
         return 1;
-    std::ifstream file{argv[1]};
+    AOC_ALLOC_PHASE("parse");
+    InputStream file{argv[1]};
     Buses buses{file};
+    AOC_ALLOC_PHASE("part1");
     std::cout << buses.SolvePart1() << '\n';
+    AOC_ALLOC_PHASE("part2");
     std::cout << buses.SolvePart2() << '\n';
     return 0;
 }
\ No newline at end of file
@@ -1,85 +1,179 @@
-#include <bitset>
-#include <fstream>
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <numeric>
 #include <string>
 #include <string_view>
-#include <type_traits>
-#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
 
-#ifdef __has_builtin
-#   if __has_builtin(__builtin_clzll)
-#       define HAVE_CLZLL true
-#   endif
+#include "common/alloc_profile.h"
+#include "common/cpu_dispatch.h"
+#include "common/flat_hash.h"
+#include "common/parallel.h"
+#include "common/parse.h"
+#include "common/stream_input.h"
+
+#if AOC_X86_DISPATCH && __has_include(<immintrin.h>)
+#   include <immintrin.h>
+#   define HAVE_PDEP true
+#else
+#   define HAVE_PDEP false
 #endif
-#ifdef HAVE_CLZLL
-    constexpr auto clzll = [] (auto val) { return __builtin_clzll(val); };
+
+// Writes base with every combination of the floating bits set to out, 1 << popcount(floating) addresses in all.
+void ExpandFloatingScalar(uint64_t base, uint64_t floating, uint64_t* out) noexcept {
+    // Steps through every subset of floating, starting and finishing at the empty one.
+    auto subset = 0ull;
+    do {
+        *out++ = base | subset;
+        subset = (subset - floating) & floating;
+    } while (subset != 0);
+}
+
+#if HAVE_PDEP
+// Deposits a counter into the floating bits instead. pdep is a single fast instruction on Intel, but microcoded and
+// far slower on AMD before Zen 3, which AOC_ISA=sse4.2 gets around.
+AOC_TARGET_AVX2 void ExpandFloatingPdep(uint64_t base, uint64_t floating, uint64_t* out) noexcept {
+    const auto permutations = 1ull << std::popcount(floating);
+    for (uint64_t i = 0; i < permutations; ++i)
+        out[i] = base | _pdep_u64(i, floating);
+}
+#endif
+
+void ExpandFloating(uint64_t base, uint64_t floating, uint64_t* out) {
+    using Kernel = decltype(ExpandFloatingScalar);
+#if HAVE_PDEP
+    static auto* const kernel = KernelVariants<Kernel>{ExpandFloatingScalar, nullptr, ExpandFloatingPdep}.Select();
 #else
-#   define HAVE_CLZLL false
-    constexpr auto clzll = [] (auto val) {};
+    static auto* const kernel = KernelVariants<Kernel>{ExpandFloatingScalar}.Select();
 #endif
-constexpr bool haveClzll = HAVE_CLZLL;
+    kernel(base, floating, out);
+}
+
+struct Mask {
+    uint64_t zeros = 0;
+    uint64_t ones = 0;
+    uint64_t floating = 0;
+};
+
+struct Write {
+    uint64_t addr;
+    uint64_t value;
+};
+
+// The program decoded once into a flat buffer, with masks already split into their bit sets.
+using Instruction = std::variant<Mask, Write>;
+using Program = std::vector<Instruction>;
+
+[[nodiscard]] Mask ParseMask(std::istream& in) {
+    std::string bits;
+    std::getline(in, bits);
+    Mask mask;
+    for (auto i = 0; i < bits.size(); ++i) {
+        auto bit = *(bits.rbegin() + i);
+        if (bit == '0')
+            mask.zeros |= 1ull << i;
+        else if (bit == '1')
+            mask.ones |= 1ull << i;
+        else if (bit == 'X')
+            mask.floating |= 1ull << i;
+    }
+    return mask;
+}
+
+[[nodiscard]] Write ParseWrite(std::istream& in) {
+    std::string line;
+    std::getline(in, line);
+    Write write{};
+    const auto* end = line.data() + line.size();
+    const auto pos = ParseInt(line.data(), end, write.addr).ptr;
+    ParseInt(std::min(pos + 4, end), end, write.value);
+    return write;
+}
+
+[[nodiscard]] Program ParseProgram(std::istream& in) {
+    Program program;
+    char c[4];
+    while (in.read(c, 4)) {
+        std::string_view cmd{c, 4};
+        if (cmd == "mask")
+            program.emplace_back(ParseMask(in));
+        else if (cmd == "mem[")
+            program.emplace_back(ParseWrite(in));
+    }
+    return program;
+}
+
+struct WriteCounts {
+    uint64_t writes = 0;
+    uint64_t materialised = 0; // addresses part 2 would touch if every floating bit were expanded
+};
+
+[[nodiscard]] WriteCounts CountWrites(const Program& program) noexcept {
+    WriteCounts ret;
+    uint64_t perWrite = 1;
+    for (auto& insn : program) {
+        if (auto* mask = std::get_if<Mask>(&insn)) {
+            perWrite = 1ull << std::popcount(mask->floating);
+        } else {
+            ++ret.writes;
+            ret.materialised += perWrite;
+        }
+    }
+    return ret;
+}
 
 template <size_t N, bool IsPart2>
 class SizedMemory {
-    std::unordered_map<uint64_t, std::bitset<N>> memory;
-    std::bitset<N> andMask;
-    std::bitset<N> orMask;
-    std::bitset<N> floatMask;
+    static_assert(N < sizeof(uint64_t) * 8, "Sizes >= 64 bit are not supported");
+    static constexpr uint64_t width = (1ull << N) - 1;
+
+    FlatHashMap<uint64_t, uint64_t> memory;
+    uint64_t andMask = width;
+    uint64_t orMask = 0;
+    uint64_t floatMask = 0;
 
     class MemoryElement {
         SizedMemory& mem;
-        std::bitset<N>& element;
+        uint64_t& element;
     public:
-        MemoryElement(SizedMemory& mem, std::bitset<N>& element) noexcept : mem{mem}, element{element} {
-            static_assert(N <= sizeof(uint64_t) * 8, "Sizes > 64 bit are not supported");
-        }
+        MemoryElement(SizedMemory& mem, uint64_t& element) noexcept : mem{mem}, element{element} {}
 
         MemoryElement& operator=(uint64_t value) noexcept {
-            if constexpr (!IsPart2)
-                element = (std::bitset<N>{value} & mem.andMask) | mem.orMask;
-            else
-                element = std::bitset<N>{value};
+            element = (value & mem.andMask) | mem.orMask;
             return *this;
         }
     };
 
     class MemoryDecoder {
         SizedMemory& mem;
-        std::bitset<N> addr;
-
-        [[nodiscard]] static uint8_t HighestBit(const std::bitset<N>& value) noexcept {
-            if (value.none())
-                return 0;
-            if constexpr (haveClzll)
-                return N - (clzll(value.to_ullong()) - ((sizeof(unsigned long long) * 8) - N));
-            uint8_t pos = N;
-            while (!value[--pos]);
-            return pos + 1;
-        }
-
-        [[nodiscard]] std::bitset<N> CalcFloatPermutation(std::bitset<N> permute) const noexcept {
-            std::bitset<N> ret;
-            auto offset = 0;
-            for (auto i = 0; i < HighestBit(permute); ++i) {
-                while (!mem.floatMask[offset])
-                    ++offset;
-                ret[offset++] = permute[i];
-            }
-            return ret;
-        }
+        uint64_t addr;
     public:
         MemoryDecoder(SizedMemory& mem, uint64_t addr) noexcept : mem{mem}, addr{addr} {}
-        MemoryDecoder& operator=(uint64_t value) noexcept {
+        MemoryDecoder& operator=(uint64_t value) {
             const auto baseAddr = (addr | mem.orMask) & ~mem.floatMask;
-            for (auto i = 0; i < (1ull << mem.floatMask.count()); ++i)
-                mem.memory[(baseAddr | CalcFloatPermutation(i)).to_ullong()] = value;
+            const auto permutations = 1ull << std::popcount(mem.floatMask);
+            value &= width;
+            mem.addresses.resize(permutations);
+            ExpandFloating(baseAddr, mem.floatMask, mem.addresses.data());
+            for (auto address : mem.addresses)
+                mem.memory[address] = value;
             return *this;
         }
     };
+
+    std::vector<uint64_t> addresses; // scratch for each part 2 write's expansion
 public:
-    SizedMemory() {
-        memory.reserve(70000);
+    // Sizes the table for an upper bound on the distinct addresses the program writes. Overlapping writes make that
+    // bound loose, so it's capped and the table left to grow past it if the addresses really are that many.
+    void Reserve(const WriteCounts& counts) {
+        constexpr uint64_t reserveLimit = 1 << 20;
+        memory.reserve(std::min(IsPart2 ? counts.materialised : counts.writes, reserveLimit));
     }
 
     [[nodiscard]] auto operator[](uint64_t addr) {
@@ -89,83 +183,136 @@ public:
             return MemoryDecoder{*this, addr};
     }
 
-    void SetMask(std::string_view bits) noexcept {
-        andMask = 0xFFFFFFFFFFFFFFFF;
-        orMask = 0;
-        floatMask = 0;
-        for (auto i = 0; i < bits.size(); ++i) {
-            auto bit = *(bits.rbegin() + i);
-            if (bit == '0')
-                andMask[i] = false;
-            else if (bit == '1')
-                orMask[i] = true;
-            else if (bit == 'X')
-                floatMask[i] = true;
-        }
+    void SetMask(const Mask& mask) noexcept {
+        andMask = width & ~mask.zeros;
+        orMask = mask.ones;
+        floatMask = mask.floating;
     }
 
-    [[nodiscard]] auto begin() const noexcept {
-        return memory.begin();
-    }
-
-    [[nodiscard]] auto end() const noexcept {
-        return memory.end();
+    [[nodiscard]] uint64_t Sum() const {
+        const auto parts = ChunksFor(memory.size(), sizeof(*memory.begin()));
+        return ParallelReduce(parts, 0ull, std::plus{}, [this, parts] (size_t part) {
+            auto segment = memory.Segment(part, parts);
+            return std::transform_reduce(segment.begin(), segment.end(), 0ull, std::plus{},
+                                         [] (auto& kvp) { return kvp.second; });
+        });
     }
 };
 
-template <size_t N, bool IsPart2>
-class ProgramExecutor {
-    SizedMemory<N, IsPart2> memory;
+// Part 2 memory which never expands floating bits. Each write is recorded as a pattern of fixed address bits plus
+// a floating mask, and the sum is taken newest write first: a write only contributes for the addresses which no
+// later write covers, found by carving every later pattern out of it.
+template <size_t N>
+class SymbolicMemory {
+    static_assert(N <= sizeof(uint64_t) * 8, "Sizes > 64 bit are not supported");
+    static constexpr uint64_t width = N == 64 ? ~0ull : (1ull << N) - 1;
+
+    struct Pattern {
+        uint64_t fixed;
+        uint64_t floating;
+    };
+
+    struct PatternWrite {
+        Pattern pattern;
+        uint64_t value;
+    };
+
+    std::vector<PatternWrite> writes;
+    uint64_t orMask = 0;
+    uint64_t floatMask = 0;
+
+    class PatternWriter {
+        SymbolicMemory& mem;
+        uint64_t addr;
+    public:
+        PatternWriter(SymbolicMemory& mem, uint64_t addr) noexcept : mem{mem}, addr{addr} {}
+        PatternWriter& operator=(uint64_t value) {
+            mem.writes.push_back({{(addr | mem.orMask) & ~mem.floatMask, mem.floatMask}, value & width});
+            return *this;
+        }
+    };
+
+    // Appends the disjoint pieces of `from` which lie outside of `cut`.
+    static void Subtract(Pattern from, const Pattern& cut, std::vector<Pattern>& out) {
+        if ((from.fixed ^ cut.fixed) & ~from.floating & ~cut.floating) {
+            out.push_back(from);
+            return;
+        }
+        for (auto split = from.floating & ~cut.floating; split; split &= split - 1) {
+            auto bit = split & -split;
+            from.floating &= ~bit;
+            out.push_back({from.fixed | (~cut.fixed & bit), from.floating});
+            from.fixed |= cut.fixed & bit;
+        }
+    }
+public:
+    void Reserve(const WriteCounts& counts) {
+        writes.reserve(counts.writes);
+    }
 
-    void HandleMask(std::istream& in) {
-        std::string mask;
-        std::getline(in, mask);
-        memory.SetMask(mask);
+    [[nodiscard]] auto operator[](uint64_t addr) noexcept {
+        return PatternWriter{*this, addr};
     }
 
-    void HandleWrite(std::istream& in) {
-        uint64_t addr, value;
-        in >> addr;
-        in.ignore(4);
-        in >> value;
-        in.ignore(1);
-        memory[addr] = value;
+    void SetMask(const Mask& mask) noexcept {
+        orMask = mask.ones;
+        floatMask = mask.floating;
     }
 
-    void Execute(std::istream& in) {
-        char c[4];
-        while (in) {
-            in.read(c, 4);
-            std::string_view cmd{c, 4};
-            if (cmd == "mask")
-                HandleMask(in);
-            else if(cmd == "mem[")
-                HandleWrite(in);
+    [[nodiscard]] uint64_t Sum() const {
+        uint64_t sum = 0;
+        std::vector<Pattern> live, carved;
+        for (auto write = writes.rbegin(); write != writes.rend(); ++write) {
+            live.assign(1, write->pattern);
+            for (auto later = writes.rbegin(); later != write && !live.empty(); ++later) {
+                carved.clear();
+                for (auto& pattern : live)
+                    Subtract(pattern, later->pattern, carved);
+                std::swap(live, carved);
+            }
+            for (auto& pattern : live)
+                sum += write->value << std::popcount(pattern.floating);
         }
+        return sum;
     }
-public:
+};
 
-    [[nodiscard]] uint64_t Solve(std::istream& in) {
-        Execute(in);
-        constexpr auto reducer = [] (auto a, auto& b) { return a + b.second.to_ullong(); };
-        return std::reduce(memory.begin(), memory.end(), 0ull, reducer);
+template <class Memory>
+class ProgramExecutor {
+    Memory memory;
+public:
+    [[nodiscard]] uint64_t Solve(const Program& program) {
+        memory.Reserve(CountWrites(program));
+        for (auto& insn : program) {
+            if (auto* mask = std::get_if<Mask>(&insn))
+                memory.SetMask(*mask);
+            else if (auto* write = std::get_if<Write>(&insn))
+                memory[write->addr] = write->value;
+        }
+        return memory.Sum();
     }
 };
 
+// Expanding floating bits costs a table entry per materialised address, so it's only done while those fit in a fixed
+// memory budget. Anything larger is summed symbolically, which stores one pattern per write however many it covers.
+[[nodiscard]] uint64_t SolvePart2(const Program& program) {
+    constexpr uint64_t materialiseBudget = 64ull << 20;
+    constexpr uint64_t entryBytes = 2 * sizeof(uint64_t);
+    if (CountWrites(program).materialised <= materialiseBudget / entryBytes)
+        return ProgramExecutor<SizedMemory<36, true>>{}.Solve(program);
+    return ProgramExecutor<SymbolicMemory<36>>{}.Solve(program);
+}
+
 int main(int argc, const char* argv[]) {
     if (argc != 2)
         return 1;
-    std::ifstream file{argv[1]};
-    {
-        ProgramExecutor<36, false> part1;
-        std::cout << part1.Solve(file) << '\n';
-    }
-
-    file.clear();
-    file.seekg(0);
-
-    {
-        ProgramExecutor<36, true> part2;
-        std::cout << part2.Solve(file) << '\n';
-    }
+    AOC_ALLOC_PHASE("parse");
+    InputStream file{argv[1]};
+    const auto program = ParseProgram(file);
+    AOC_ALLOC_PHASE("solve"); // the parts run concurrently
+    auto part1 = std::async(std::launch::async, [&program] {
+        return ProgramExecutor<SizedMemory<36, false>>{}.Solve(program);
+    });
+    auto part2 = SolvePart2(program);
+    std::cout << part1.get() << '\n' << part2 << '\n';
 }
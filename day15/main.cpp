@@ -1,89 +1,356 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
 #include <cstdint>
-#include <fstream>
+#include <cstring>
 #include <iostream>
-#include <unordered_set>
+#include <limits>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 
-class Number {
-    uint32_t value;
-    mutable uint32_t turnLastSpoken = 0;
-    mutable uint32_t turnPenultimateSpoken = 0;
-    mutable uint32_t timesSpoken = 0;
+#include "common/alloc_profile.h"
+#include "common/instrument.h"
+#include "common/parse.h"
+#include "common/serve.h"
+#include "common/stream_input.h"
+
+#if __has_include(<sys/mman.h>)
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <unistd.h>
+#   define HAVE_MMAP true
+#else
+#   define HAVE_MMAP false
+#endif
+
+// A zero-initialised block of memory. Where mmap is available the pages are only faulted in once touched, and the
+// block can instead map a file so that its contents outlive the process.
+class LargeRegion {
+    std::byte* data = nullptr;
+    size_t bytes;
+    int fd = -1;
 public:
-    explicit Number(uint32_t value) noexcept : value{value} {}
+    explicit LargeRegion(size_t bytes) : bytes{bytes} {
+#if HAVE_MMAP
+        auto* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED)
+            throw std::bad_alloc{};
+        data = static_cast<std::byte*>(mem);
+#   ifdef MADV_HUGEPAGE
+        Advise(0, bytes, MADV_HUGEPAGE);
+#   endif
+#else
+        data = new std::byte[bytes]();
+#endif
+    }
 
-    [[nodiscard]] uint32_t Diff() const noexcept {
-        return turnLastSpoken - turnPenultimateSpoken;
+    // The file is resized to `bytes` if needed; an existing file of the right size keeps its contents.
+    LargeRegion(const std::string& path, size_t bytes) : bytes{bytes} {
+#if HAVE_MMAP
+        fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd == -1 || (lseek(fd, 0, SEEK_END) != static_cast<off_t>(bytes) && ftruncate(fd, bytes) != 0))
+            throw std::runtime_error{"Unable to open " + path + ": " + std::strerror(errno)};
+        auto* mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mem == MAP_FAILED)
+            throw std::runtime_error{"Unable to map " + path + ": " + std::strerror(errno)};
+        data = static_cast<std::byte*>(mem);
+#else
+        throw std::runtime_error{"File-backed regions need mmap."};
+#endif
     }
+    LargeRegion(const LargeRegion&) = delete;
+    LargeRegion& operator=(const LargeRegion&) = delete;
 
-    uint32_t TimesSpoken() const noexcept {
-        return timesSpoken;
+    ~LargeRegion() {
+#if HAVE_MMAP
+        if (data)
+            munmap(data, bytes);
+        if (fd != -1)
+            close(fd);
+#else
+        delete[] data;
+#endif
     }
 
-    void TurnLastSpoken(uint32_t val) const noexcept {
-        turnPenultimateSpoken = turnLastSpoken;
-        ++timesSpoken;
-        turnLastSpoken = val;
+    template <class T>
+    [[nodiscard]] T* As(size_t offset = 0) noexcept {
+        return reinterpret_cast<T*>(data + offset);
     }
 
-    operator uint32_t() const noexcept {
-        return value;
+    void Advise(size_t offset, size_t length, [[maybe_unused]] int advice) noexcept {
+#if HAVE_MMAP
+        constexpr size_t pageMask = 4095;
+        const auto begin = (offset + pageMask) & ~pageMask;
+        if (begin < offset + length)
+            madvise(data + begin, offset + length - begin, advice);
+#endif
     }
 
-    bool operator==(const Number& rhs) const noexcept {
-        return value == rhs.value;
+    // Zeroes a file-backed region without touching every page.
+    void Reset() {
+#if HAVE_MMAP
+        if (fd != -1 && (ftruncate(fd, 0) != 0 || ftruncate(fd, bytes) != 0))
+            throw std::runtime_error{std::string{"Unable to reset game state: "} + std::strerror(errno)};
+#endif
     }
 
-    struct Hash {
-        auto operator()(const Number& number) const noexcept {
-            return std::hash<uint32_t>{}(number);
-        }
-    };
+    // Writes the dirty pages of part of a file-backed region out, returning once they're on disk.
+    void Sync(size_t offset, size_t length) {
+#if HAVE_MMAP
+        constexpr size_t pageMask = 4095;
+        const auto begin = offset & ~pageMask;
+        if (fd != -1 && msync(data + begin, offset + length - begin, MS_SYNC) != 0)
+            throw std::runtime_error{std::string{"Unable to save game state: "} + std::strerror(errno)};
+#endif
+    }
 };
 
+[[nodiscard]] std::vector<uint32_t> ParseStartingNumbers(std::istream& in) {
+    return ParseInts<uint32_t>(ReadAll(in), ',');
+}
+
 class MemoryGame {
-    std::unordered_set<Number, Number::Hash> numbers;
-    const Number* lastSpoken;
-    uint32_t currentTurn = 0;
+    // Heads a file-backed game and names its latest checkpoint. The file holds two copies of the table: the game is
+    // played on one while the other keeps the checkpoint. Taking a checkpoint syncs the live copy, names it here and
+    // syncs that, and only then carries on in a fresh copy of it, so a named copy is never written to again and,
+    // whatever a crash leaves behind, the header names one whole turn's table.
+    struct Checkpoint {
+        char magic[8];
+        uint32_t version;
+        uint32_t maxTurn;
+        uint64_t startingHash;
+        uint32_t turn;
+        uint32_t lastSpoken;
+        uint32_t slot;
+    };
+    static constexpr char magic[8] = "AOC15MG";
+    static constexpr uint32_t version = 2;
+    static constexpr size_t pageSize = 4096;
+    static constexpr uint32_t lowLimit = 1 << 16;
+    static constexpr uint64_t checkpointInterval = 1 << 26;
+
+    size_t tableBytes;
+    LargeRegion storage;
+    Checkpoint* checkpoint = nullptr; // only for a file-backed game
+    uint64_t startingHash;
+    uint32_t slot = 0;
+    bool forkPending = false;
+    // The turn each number was last spoken on, indexed by the number itself; 0 means it hasn't been spoken yet.
+    // No number can exceed the turn count, so this is a single flat region sized once up front. Most lookups land in
+    // its first lowLimit entries, which a file-backed game reads ahead; the rest of it is advised as random access.
+    uint32_t* turnLastSpoken;
+    uint32_t lastSpoken;
+    uint32_t currentTurn;
+    uint32_t maxTurn;
+
+    [[nodiscard]] static size_t TableBytes(const std::vector<uint32_t>& starting, uint32_t maxTurn) noexcept {
+        const auto largest = starting.empty() ? 0 : *std::ranges::max_element(starting);
+        const auto entries = std::max<size_t>(maxTurn, largest + 1ull);
+        return (entries * sizeof(uint32_t) + pageSize - 1) & ~(pageSize - 1);
+    }
+
+    [[nodiscard]] static uint64_t Hash(const std::vector<uint32_t>& starting) noexcept {
+        uint64_t hash = 0xCBF29CE484222325ull;
+        for (auto value : starting)
+            hash = (hash ^ value) * 0x100000001B3ull;
+        return hash;
+    }
+
+    [[nodiscard]] size_t TableOffset(uint32_t copy) const noexcept {
+        return checkpoint ? pageSize + copy * tableBytes : 0;
+    }
+
+    [[nodiscard]] uint32_t* Table(uint32_t copy) noexcept {
+        return storage.As<uint32_t>(TableOffset(copy));
+    }
+
+    // Copying the table costs about as much as a few turns per entry, so large tables checkpoint less often.
+    [[nodiscard]] uint64_t CheckpointInterval() const noexcept {
+        return std::max<uint64_t>(checkpointInterval, tableBytes / sizeof(uint32_t) / 8);
+    }
+
+    [[nodiscard]] bool Resume() noexcept {
+        if (std::memcmp(checkpoint->magic, magic, sizeof(magic)) != 0 || checkpoint->version != version ||
+            checkpoint->maxTurn != maxTurn || checkpoint->startingHash != startingHash || checkpoint->slot > 1)
+            return false;
+        slot = checkpoint->slot;
+        turnLastSpoken = Table(slot);
+        currentTurn = checkpoint->turn;
+        lastSpoken = checkpoint->lastSpoken;
+        forkPending = true;
+        return true;
+    }
+
+    void Start(const std::vector<uint32_t>& starting) {
+        storage.Reset();
+        slot = 0;
+        turnLastSpoken = Table(slot);
+        for (uint32_t i = 0; i + 1 < starting.size(); ++i)
+            turnLastSpoken[starting[i]] = i + 1;
+        lastSpoken = starting.back();
+        currentTurn = starting.size();
+    }
+
+    void SaveCheckpoint() {
+        if (!checkpoint || forkPending)
+            return;
+        storage.Sync(TableOffset(slot), tableBytes);
+        Checkpoint saved{};
+        std::memcpy(saved.magic, magic, sizeof(magic));
+        saved.version = version;
+        saved.maxTurn = maxTurn;
+        saved.startingHash = startingHash;
+        saved.turn = currentTurn;
+        saved.lastSpoken = lastSpoken;
+        saved.slot = slot;
+        *checkpoint = saved;
+        storage.Sync(0, sizeof(Checkpoint));
+        forkPending = true;
+    }
+
+    // Moves play off the checkpointed copy of the table, before the next turn would change it.
+    void Fork() noexcept {
+        forkPending = false;
+        const auto fresh = slot ^ 1;
+        std::memcpy(Table(fresh), turnLastSpoken, tableBytes);
+        slot = fresh;
+        turnLastSpoken = Table(slot);
+    }
+
+    // lastSpoken is only recorded once the next number has been worked out from its previous turn.
+    void DoTurn() noexcept {
+        AOC_COUNT("day15.DoTurn");
+        if (lastSpoken >= lowLimit)
+            AOC_COUNT("day15.DoTurn.coldLookups");
+        auto& previous = turnLastSpoken[lastSpoken];
+        auto next = previous == 0 ? 0 : currentTurn - previous;
+        AOC_HISTOGRAM("day15.DoTurn.gap", next);
+        previous = currentTurn++;
+        lastSpoken = next;
+    }
 public:
-    explicit MemoryGame(std::istream& in) {
-        uint32_t value;
-        while (in >> value) {
-            auto elem = numbers.emplace(value);
-            lastSpoken = &*elem.first;
-            lastSpoken->TurnLastSpoken(++currentTurn);
-            in.ignore(1);
-        }
+    MemoryGame(const std::vector<uint32_t>& starting, uint32_t maxTurn) :
+        tableBytes{TableBytes(starting, maxTurn)}, storage{tableBytes}, startingHash{Hash(starting)},
+        maxTurn{maxTurn} {
+        Start(starting);
     }
-    MemoryGame(const MemoryGame& rhs) :
-        numbers{rhs.numbers}, lastSpoken{&*numbers.find(*rhs.lastSpoken)}, currentTurn{rhs.currentTurn} {
-        numbers.reserve(4'000'000);
+
+    // Keeps the game in statePath, resuming from its latest checkpoint if it holds this same game.
+    MemoryGame(const std::vector<uint32_t>& starting, uint32_t maxTurn, const std::string& statePath) :
+        tableBytes{TableBytes(starting, maxTurn)}, storage{statePath, pageSize + 2 * tableBytes},
+        checkpoint{storage.As<Checkpoint>()}, startingHash{Hash(starting)}, maxTurn{maxTurn} {
+        const auto hot = std::min<size_t>(lowLimit * sizeof(uint32_t), tableBytes);
+#if HAVE_MMAP
+        for (uint32_t copy = 0; copy < 2; ++copy) {
+            storage.Advise(TableOffset(copy), hot, MADV_WILLNEED);
+            storage.Advise(TableOffset(copy) + hot, tableBytes - hot, MADV_RANDOM);
+        }
+#endif
+        if (!Resume())
+            Start(starting);
     }
 
-    void DoTurn() {
-        if (lastSpoken->TimesSpoken() == 1) {
-            auto& elem = *numbers.emplace(0).first;
-            elem.TurnLastSpoken(++currentTurn);
-            lastSpoken = &elem;
-        } else {
-            auto& elem = *numbers.emplace(lastSpoken->Diff()).first;
-            elem.TurnLastSpoken(++currentTurn);
-            lastSpoken = &elem;
+    [[nodiscard]] uint32_t GetLastSpokenForTurn(uint32_t turn) {
+        if (turn > maxTurn || turn < currentTurn)
+            throw std::out_of_range{"Turn " + std::to_string(turn) + " is outside this game."};
+        const auto interval = CheckpointInterval();
+        while (currentTurn != turn) {
+            if (forkPending)
+                Fork();
+            const auto stop = std::min<uint64_t>(turn, (currentTurn / interval + 1) * interval);
+            AOC_TIME_SCOPE("day15.GetLastSpokenForTurn.block");
+            while (currentTurn != stop)
+                DoTurn();
+            SaveCheckpoint();
         }
+        return lastSpoken;
+    }
+};
+
+// Every number spoken up to maxTurn, so that any of those turns can be looked up without replaying the game.
+class SpokenHistory {
+    std::vector<uint32_t> spoken;
+public:
+    SpokenHistory(const std::vector<uint32_t>& starting, uint32_t maxTurn) {
+        spoken.reserve(std::max<size_t>(maxTurn, starting.size()));
+        spoken.assign(starting.begin(), starting.end());
+        MemoryGame game{starting, maxTurn};
+        for (uint32_t turn = starting.size() + 1; turn <= maxTurn; ++turn)
+            spoken.push_back(game.GetLastSpokenForTurn(turn));
     }
 
-    uint32_t GetLastSpokenForTurn(uint32_t turn) {
-        while (currentTurn != turn)
-            DoTurn();
-        return *lastSpoken;
+    [[nodiscard]] uint32_t ForTurn(uint32_t turn) const {
+        if (turn == 0 || turn > spoken.size())
+            throw std::out_of_range{"Turn " + std::to_string(turn) + " is outside this game."};
+        return spoken[turn - 1];
     }
 };
 
+// Answers "<turn>" with the number spoken on it, for any turn up to maxTurn.
+[[noreturn]] void Serve(const char* socketPath, const std::vector<uint32_t>& starting, uint32_t maxTurn) {
+    const SpokenHistory history{starting, maxTurn};
+    QueryServer{[&history] (const QueryWords& words) {
+        const auto [turn] = QueryInts<uint32_t, 1>(words, "<turn>");
+        return std::to_string(history.ForTurn(turn));
+    }}.Run(socketPath);
+}
+
+// The turn count given at argv[index], if any. Turns are numbered from 1 in 32 bits, so 0 or a count beyond that is
+// refused.
+[[nodiscard]] std::optional<uint32_t> TurnsArgument(int argc, const char* argv[], int index) {
+    if (argc <= index)
+        return 30'000'000;
+    const auto turns = ToInt<uint32_t>(argv[index]);
+    if (!turns || *turns == 0) {
+        std::cerr << "Turn counts must be between 1 and " << std::numeric_limits<uint32_t>::max() << ".\n";
+        return std::nullopt;
+    }
+    return turns;
+}
+
+// A game is played from its last starting number, so there must be one, and it can't be asked to stop before the
+// starting numbers have all been spoken.
+[[nodiscard]] bool CanPlay(const std::vector<uint32_t>& starting, uint32_t maxTurn) {
+    if (starting.empty()) {
+        std::cerr << "The input has no starting numbers.\n";
+        return false;
+    }
+    if (starting.size() > maxTurn) {
+        std::cerr << "A game of " << maxTurn << " turns can't start with " << starting.size() << " numbers.\n";
+        return false;
+    }
+    return true;
+}
+
 int main(int argc, const char* argv[]) {
-    if (argc != 2)
+    if ((argc == 4 || argc == 5) && std::string_view{argv[1]} == "--serve") {
+        const auto maxTurn = TurnsArgument(argc, argv, 4);
+        if (!maxTurn)
+            return 1;
+        InputStream file{argv[3]};
+        const auto starting = ParseStartingNumbers(file);
+        if (!CanPlay(starting, *maxTurn))
+            return 1;
+        Serve(argv[2], starting, *maxTurn);
+    }
+    if (argc < 2)
+        return 1;
+    const auto part2Turns = TurnsArgument(argc, argv, 2);
+    if (!part2Turns)
+        return 1;
+    AOC_ALLOC_PHASE("parse");
+    InputStream file{argv[1]};
+    const auto starting = ParseStartingNumbers(file);
+    if (!CanPlay(starting, std::min<uint32_t>(2'020, *part2Turns)))
         return 1;
-    std::ifstream file{argv[1]};
-    MemoryGame part1{file};
-    MemoryGame part2 = part1;
+    AOC_ALLOC_PHASE("part1");
+    MemoryGame part1{starting, 2'020};
     std::cout << part1.GetLastSpokenForTurn(2'020) << '\n';
-    std::cout << part2.GetLastSpokenForTurn(30'000'000) << '\n';
+    AOC_ALLOC_PHASE("part2");
+    auto part2 = argc > 3 ? MemoryGame{starting, *part2Turns, argv[3]} : MemoryGame{starting, *part2Turns};
+    std::cout << part2.GetLastSpokenForTurn(*part2Turns) << '\n';
 }
@@ -1,13 +1,25 @@
 #include <algorithm>
+#include <array>
+#include <bit>
 #include <cstdint>
-#include <fstream>
+#include <functional>
 #include <iostream>
-#include <numeric>
+#include <limits>
+#include <memory_resource>
+#include <span>
+#include <stdexcept>
 #include <string>
-#include <unordered_map>
-#include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include "common/alloc_profile.h"
+#include "common/arena.h"
+#include "common/cpu_dispatch.h"
+#include "common/input_cache.h"
+#include "common/parallel.h"
+#include "common/parse.h"
+#include "common/stream_input.h"
+
 class ValidityRange {
     int16_t min;
     int16_t max;
@@ -17,6 +29,14 @@ public:
     [[nodiscard]] bool IsValid(int16_t value) const noexcept {
         return value >= min && value <= max;
     }
+
+    [[nodiscard]] int16_t Min() const noexcept {
+        return min;
+    }
+
+    [[nodiscard]] int16_t Max() const noexcept {
+        return max;
+    }
 };
 
 class Attribute {
@@ -25,6 +45,14 @@ class Attribute {
     ValidityRange second;
 public:
     Attribute(std::string name, ValidityRange first, ValidityRange second) : name{std::move(name)}, first{first}, second{second} {}
+    explicit Attribute(CacheReader& cache) :
+        name{cache.ReadString()}, first{cache.Read<ValidityRange>()}, second{cache.Read<ValidityRange>()} {}
+
+    void Save(CacheWriter& cache) const {
+        cache.WriteString(name);
+        cache.Write(first);
+        cache.Write(second);
+    }
 
     [[nodiscard]] bool IsValid(int16_t value) const noexcept {
         return first.IsValid(value) || second.IsValid(value);
@@ -33,45 +61,192 @@ public:
     [[nodiscard]] const std::string& Name() const noexcept {
         return name;
     }
+
+    [[nodiscard]] int16_t Max() const noexcept {
+        return std::max(first.Max(), second.Max());
+    }
+
+    [[nodiscard]] std::array<ValidityRange, 2> Ranges() const noexcept {
+        return {first, second};
+    }
 };
 
 class TicketAttributes {
     std::vector<Attribute> attributes;
 public:
     explicit TicketAttributes(std::istream& in) {
-        std::string name;
-        int16_t min1, max1, min2, max2;
-        while (in.peek() != '\n') {
-            std::getline(in, name, ':');
-            in >> min1;
-            in.ignore(1);
-            in >> max1;
-            in.ignore(4);
-            in >> min2;
-            in.ignore(1);
-            in >> max2;
-            in.ignore();
-            attributes.emplace_back(std::move(name), ValidityRange{min1, max1}, ValidityRange{min2, max2});
+        std::string line;
+        while (std::getline(in, line) && !line.empty()) {
+            const auto colon = std::min(line.find(':'), line.size());
+            const char* end = line.data() + line.size();
+            int16_t min1 = 0, max1 = 0, min2 = 0, max2 = 0;
+            auto pos = ParseInt(std::min<const char*>(line.data() + colon + 2, end), end, min1).ptr;
+            pos = ParseInt(std::min(pos + 1, end), end, max1).ptr;
+            pos = ParseInt(std::min(pos + 4, end), end, min2).ptr;
+            ParseInt(std::min(pos + 1, end), end, max2);
+            attributes.emplace_back(line.substr(0, colon), ValidityRange{min1, max1}, ValidityRange{min2, max2});
         }
-        in.ignore();
         in.ignore(std::numeric_limits<std::streamsize>::max(), '\n'); // Puts us at our ticket.
     }
 
+    explicit TicketAttributes(CacheReader& cache) {
+        const auto count = cache.Read<uint64_t>();
+        attributes.reserve(count);
+        for (uint64_t i = 0; i < count; ++i)
+            attributes.emplace_back(cache);
+    }
+
+    void Save(CacheWriter& cache) const {
+        cache.Write<uint64_t>(attributes.size());
+        for (auto& attrib : attributes)
+            attrib.Save(cache);
+    }
+
     [[nodiscard]] const auto& Attributes() const noexcept {
         return attributes;
     }
 };
 
+// A range as the kernel below tests it: value - first <= span, in 16-bit unsigned arithmetic.
+struct SpanRange {
+    uint16_t first;
+    uint16_t span;
+};
+
+// Clears keep[i] for each of the count values that's outside every range. The values go through in blocks, one
+// range at a time, so that each pass is a plain compare across as many lanes as the ISA has.
+AOC_KERNEL_INLINE void KeepInRangesBody(const uint16_t* values, size_t count, const SpanRange* ranges, size_t rangeCount,
+                                        uint8_t* keep) noexcept {
+    constexpr size_t block = 256;
+    for (size_t base = 0; base < count; base += block) {
+        const auto size = std::min(block, count - base);
+        uint8_t inRange[block] = {};
+        for (size_t r = 0; r < rangeCount; ++r) {
+            const auto first = ranges[r].first, span = ranges[r].span;
+            for (size_t i = 0; i < size; ++i)
+                inRange[i] |= static_cast<uint16_t>(values[base + i] - first) <= span;
+        }
+        for (size_t i = 0; i < size; ++i)
+            keep[base + i] &= inRange[i];
+    }
+}
+
+void KeepInRangesScalar(const uint16_t* values, size_t count, const SpanRange* ranges, size_t rangeCount,
+                        uint8_t* keep) noexcept {
+    KeepInRangesBody(values, count, ranges, rangeCount, keep);
+}
+
+AOC_TARGET_SSE42 void KeepInRangesSse42(const uint16_t* values, size_t count, const SpanRange* ranges,
+                                        size_t rangeCount, uint8_t* keep) noexcept {
+    KeepInRangesBody(values, count, ranges, rangeCount, keep);
+}
+
+AOC_TARGET_AVX2 void KeepInRangesAvx2(const uint16_t* values, size_t count, const SpanRange* ranges, size_t rangeCount,
+                                      uint8_t* keep) noexcept {
+    KeepInRangesBody(values, count, ranges, rangeCount, keep);
+}
+
+AOC_TARGET_AVX512 void KeepInRangesAvx512(const uint16_t* values, size_t count, const SpanRange* ranges,
+                                          size_t rangeCount, uint8_t* keep) noexcept {
+    KeepInRangesBody(values, count, ranges, rangeCount, keep);
+}
+
+void KeepInRanges(const uint16_t* values, size_t count, const SpanRange* ranges, size_t rangeCount, uint8_t* keep) {
+    static auto* const kernel = KernelVariants<decltype(KeepInRangesScalar)>{
+        KeepInRangesScalar, KeepInRangesSse42, KeepInRangesAvx2, KeepInRangesAvx512}.Select();
+    kernel(values, count, ranges, rangeCount, keep);
+}
+
+// Maps every field value to the set of attributes it satisfies, built once so each validity check is a single
+// load. Values beyond the highest range all share one trailing entry which satisfies nothing.
+class AttributeTable {
+    // Beyond this many disjoint ranges, a lookup per value beats comparing against each of them.
+    static constexpr size_t maxKernelRanges = 8;
+
+    size_t words;
+    size_t limit = 0;
+    std::vector<uint64_t> masks;
+    std::vector<uint8_t> valid;
+    std::vector<SpanRange> validRanges; // the union of every attribute's ranges, merged and sorted
+
+    [[nodiscard]] size_t Index(uint16_t value) const noexcept {
+        return std::min<size_t>(value, limit);
+    }
+public:
+    explicit AttributeTable(const TicketAttributes& attributes) : words{(attributes.Attributes().size() + 63) / 64} {
+        for (auto& attrib : attributes.Attributes())
+            limit = std::max<size_t>(limit, attrib.Max() + 1);
+        masks.resize((limit + 1) * words);
+        valid.resize(limit + 1);
+        for (size_t value = 0; value < limit; ++value) {
+            for (size_t i = 0; i < attributes.Attributes().size(); ++i) {
+                if (attributes.Attributes()[i].IsValid(value)) {
+                    masks[value * words + i / 64] |= 1ull << (i % 64);
+                    valid[value] = true;
+                }
+            }
+        }
+        std::vector<std::pair<uint16_t, uint16_t>> bounds;
+        for (auto& attrib : attributes.Attributes()) {
+            for (auto range : attrib.Ranges()) {
+                if (range.Max() >= 0 && range.Min() <= range.Max())
+                    bounds.emplace_back(std::max<int16_t>(range.Min(), 0), range.Max());
+            }
+        }
+        std::ranges::sort(bounds);
+        for (auto [first, last] : bounds) {
+            if (!validRanges.empty() && first <= validRanges.back().first + validRanges.back().span + 1) {
+                auto& back = validRanges.back();
+                back.span = std::max<uint16_t>(back.span, last - back.first);
+            } else {
+                validRanges.push_back({first, static_cast<uint16_t>(last - first)});
+            }
+        }
+    }
+
+    [[nodiscard]] bool IsValid(uint16_t value) const noexcept {
+        return valid[Index(value)];
+    }
+
+    // Clears keep[i] for each of the count values that no attribute allows.
+    void KeepValid(const uint16_t* values, size_t count, uint8_t* keep) const {
+        if (validRanges.size() <= maxKernelRanges) {
+            KeepInRanges(values, count, validRanges.data(), validRanges.size(), keep);
+        } else {
+            for (size_t i = 0; i < count; ++i)
+                keep[i] &= IsValid(values[i]);
+        }
+    }
+
+    [[nodiscard]] bool Satisfies(uint16_t value, size_t attribute) const noexcept {
+        return masks[Index(value) * words + attribute / 64] >> (attribute % 64) & 1;
+    }
+
+    [[nodiscard]] const uint64_t* Mask(uint16_t value) const noexcept {
+        return &masks[Index(value) * words];
+    }
+
+    [[nodiscard]] size_t Words() const noexcept {
+        return words;
+    }
+};
+
 class Ticket {
     std::vector<uint16_t> values;
 public:
     explicit Ticket(std::istream& in) {
-        uint16_t value;
-        while (in >> value) {
-            values.emplace_back(value);
-            if (in.get() == '\n')
-                break;
-        }
+        std::string line;
+        std::getline(in, line);
+        ForEachInt<uint16_t>(line, ',', [this] (size_t, uint16_t value) { values.push_back(value); });
+    }
+
+    explicit Ticket(CacheReader& cache) {
+        auto cached = cache.ReadSpan<uint16_t>();
+        values.assign(cached.begin(), cached.end());
+    }
+
+    void Save(CacheWriter& cache) const {
+        cache.WriteSpan(std::span{values});
     }
 
     [[nodiscard]] const std::vector<uint16_t>& Values() const noexcept {
@@ -79,92 +254,291 @@ public:
     }
 };
 
+// Nearby tickets are held column-major, one contiguous array of values per field position, so scanning a field
+// across every ticket is a linear walk. The columns are reserved up front in a single arena.
 class Tickets {
+    using Column = std::pmr::vector<uint16_t>;
+    static constexpr size_t blockRows = 1 << 16;
+
     Ticket myTicket;
-    std::vector<Ticket> otherTickets;
+    ParseArena arena;
+    std::pmr::vector<Column> columns;
+    size_t rows = 0;
+
+    Tickets(CacheReader& cache, size_t rows) :
+        myTicket{cache}, arena{rows * myTicket.Values().size() * sizeof(uint16_t)},
+        columns(myTicket.Values().size(), &arena), rows{rows} {
+        for (auto& column : columns) {
+            auto values = cache.ReadSpan<uint16_t>();
+            column.assign(values.begin(), values.end());
+        }
+    }
 public:
-    explicit Tickets(std::istream& in) : myTicket{in} {
+    explicit Tickets(std::istream& in) : myTicket{in}, arena{in, 1}, columns(myTicket.Values().size(), &arena) {
         in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
         in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-        while (in)
-            otherTickets.emplace_back(in);
+        // Every value takes at least two bytes of input ("7,"), which bounds the row count without a second pass.
+        const auto maxRows = RemainingBytes(in) / std::max<size_t>(2 * columns.size(), 1);
+        for (auto& column : columns)
+            column.reserve(maxRows);
+        // Rows without exactly one readable value per field are skipped, so the columns stay the same length.
+        std::string line;
+        std::vector<uint16_t> row;
+        while (std::getline(in, line)) {
+            row.clear();
+            bool whole = true;
+            ForEachInt<uint16_t>(line, ',', [&row, &whole] (size_t column, uint16_t value) {
+                whole &= column == row.size();
+                row.push_back(value);
+            });
+            if (!whole || row.size() != columns.size() || row.empty())
+                continue;
+            for (size_t column = 0; column < columns.size(); ++column)
+                columns[column].push_back(row[column]);
+            ++rows;
+        }
+    }
+
+    explicit Tickets(CacheReader& cache) : Tickets{cache, cache.Read<uint64_t>()} {}
+
+    void Save(CacheWriter& cache) const {
+        cache.Write<uint64_t>(rows);
+        myTicket.Save(cache);
+        for (auto& column : columns)
+            cache.WriteSpan(std::span{column});
     }
 
     [[nodiscard]] const Ticket& MyTicket() const noexcept {
         return myTicket;
     }
 
-    [[nodiscard]] const std::vector<Ticket>& OtherTickets() const noexcept {
-        return otherTickets;
+    [[nodiscard]] const std::pmr::vector<Column>& Columns() const noexcept {
+        return columns;
     }
 
-    void DiscardInvalid(const TicketAttributes& attribs) {
-        otherTickets.erase(std::remove_if(otherTickets.begin(), otherTickets.end(), [&attribs] (auto& ticket) {
-            return std::ranges::any_of(ticket.Values(), [&attribs] (auto& value) {
-                return std::ranges::none_of(attribs.Attributes(), [value] (auto& attrib) { return attrib.IsValid(value); });
-            });
-        }), otherTickets.end());
+    // Rows are validated in blocks across threads, each block walking every column in turn, then each column is
+    // compacted in place on its own thread. No early exit, so the lookups vectorise as gathers.
+    void DiscardInvalid(const AttributeTable& table) {
+        std::vector<uint8_t> valid(rows, true);
+        ParallelFor((rows + blockRows - 1) / blockRows, [this, &table, &valid] (size_t block) {
+            const auto begin = block * blockRows;
+            const auto end = std::min(begin + blockRows, rows);
+            for (auto& column : columns)
+                table.KeepValid(column.data() + begin, end - begin, valid.data() + begin);
+        });
+        ParallelFor(columns.size(), [this, &valid] (size_t i) {
+            auto& column = columns[i];
+            size_t kept = 0;
+            for (size_t row = 0; row < rows; ++row) {
+                column[kept] = column[row];
+                kept += valid[row];
+            }
+            column.resize(kept);
+        });
+        rows = std::ranges::count(valid, true);
     }
 
-    [[nodiscard]] int8_t ValidIndexForAttribute(const Attribute& attrib, const auto& stillUnknown) const noexcept {
-        int8_t ret = -1;
-        for (auto i = 0; i < myTicket.Values().size(); ++i) {
-            if (stillUnknown.contains(i) && std::ranges::all_of(otherTickets, [i, &attrib] (auto& ticket) { return attrib.IsValid(ticket.Values()[i]); })) {
-                if (ret == -1)
-                    ret = i;
-                else
-                    return -1;
+    // For every column, the attributes which all tickets allow there: Words() per column, ANDed across tickets.
+    [[nodiscard]] std::vector<uint64_t> CandidateMatrix(const AttributeTable& table) const {
+        const auto words = table.Words();
+        std::vector<uint64_t> ret(columns.size() * words, ~0ull);
+        ParallelFor(columns.size(), [this, &table, &ret, words] (size_t column) {
+            auto* candidates = &ret[column * words];
+            for (auto value : columns[column]) {
+                const auto* mask = table.Mask(value);
+                for (size_t w = 0; w < words; ++w)
+                    candidates[w] &= mask[w];
             }
-        }
+        });
         return ret;
     }
 };
 
+// Works out which column holds each field from the candidate bitmatrix. Any column or field left with a single
+// option is settled and struck from the others; if that stalls before everything is placed, a Hopcroft-Karp
+// matching over what remains finishes the job.
+class FieldAssignment {
+    static constexpr int32_t unassigned = -1;
+
+    size_t fields;
+    size_t words;
+    std::vector<uint64_t> candidates;
+    std::vector<int32_t> columnOf;
+    std::vector<int32_t> fieldOf;
+
+    [[nodiscard]] bool Allows(size_t column, size_t field) const noexcept {
+        return candidates[column * words + field / 64] >> (field % 64) & 1;
+    }
+
+    void Assign(size_t field, size_t column) noexcept {
+        columnOf[field] = column;
+        fieldOf[column] = field;
+        for (size_t c = 0; c < fieldOf.size(); ++c)
+            candidates[c * words + field / 64] &= ~(1ull << (field % 64));
+    }
+
+    [[nodiscard]] bool AssignColumnSingletons() noexcept {
+        auto progress = false;
+        for (size_t column = 0; column < fieldOf.size(); ++column) {
+            if (fieldOf[column] != unassigned)
+                continue;
+            const auto* row = &candidates[column * words];
+            auto count = 0;
+            size_t field = 0;
+            for (size_t w = 0; w < words; ++w) {
+                count += std::popcount(row[w]);
+                if (row[w])
+                    field = w * 64 + std::countr_zero(row[w]);
+            }
+            if (count == 1) {
+                Assign(field, column);
+                progress = true;
+            }
+        }
+        return progress;
+    }
+
+    [[nodiscard]] bool AssignFieldSingletons() noexcept {
+        auto progress = false;
+        for (size_t field = 0; field < fields; ++field) {
+            if (columnOf[field] != unassigned)
+                continue;
+            auto count = 0;
+            size_t column = 0;
+            for (size_t c = 0; c < fieldOf.size(); ++c) {
+                if (fieldOf[c] == unassigned && Allows(c, field))
+                    ++count, column = c;
+            }
+            if (count == 1) {
+                Assign(field, column);
+                progress = true;
+            }
+        }
+        return progress;
+    }
+
+    bool Augment(size_t field, const std::vector<std::vector<int32_t>>& edges,
+                 std::vector<int32_t>& dist) noexcept {
+        for (auto column : edges[field]) {
+            auto next = fieldOf[column];
+            if (next == unassigned || (dist[next] == dist[field] + 1 && Augment(next, edges, dist))) {
+                columnOf[field] = column;
+                fieldOf[column] = field;
+                return true;
+            }
+        }
+        dist[field] = std::numeric_limits<int32_t>::max();
+        return false;
+    }
+
+    void MatchRemaining() {
+        std::vector<std::vector<int32_t>> edges(fields);
+        std::vector<int32_t> left;
+        for (size_t field = 0; field < fields; ++field) {
+            if (columnOf[field] != unassigned)
+                continue;
+            left.push_back(field);
+            for (size_t column = 0; column < fieldOf.size(); ++column) {
+                if (fieldOf[column] == unassigned && Allows(column, field))
+                    edges[field].push_back(column);
+            }
+        }
+        std::vector<int32_t> dist(fields), queue;
+        while (true) {
+            // Layer the free fields' alternating paths; stop once a free column is reachable.
+            queue.clear();
+            auto found = false;
+            for (auto field : left) {
+                dist[field] = columnOf[field] == unassigned ? 0 : std::numeric_limits<int32_t>::max();
+                if (dist[field] == 0)
+                    queue.push_back(field);
+            }
+            for (size_t i = 0; i < queue.size(); ++i) {
+                for (auto column : edges[queue[i]]) {
+                    auto next = fieldOf[column];
+                    if (next == unassigned)
+                        found = true;
+                    else if (dist[next] == std::numeric_limits<int32_t>::max()) {
+                        dist[next] = dist[queue[i]] + 1;
+                        queue.push_back(next);
+                    }
+                }
+            }
+            if (!found)
+                break;
+            for (auto field : left) {
+                if (columnOf[field] == unassigned)
+                    Augment(field, edges, dist);
+            }
+        }
+        if (std::ranges::any_of(left, [this] (auto field) { return columnOf[field] == unassigned; }))
+            throw std::runtime_error{"No column assignment satisfies every field."};
+    }
+public:
+    FieldAssignment(std::vector<uint64_t> candidates, size_t fields, size_t words) :
+        fields{fields}, words{words}, candidates{std::move(candidates)}, columnOf(fields, unassigned),
+        fieldOf(this->candidates.size() / words, unassigned) {}
+
+    [[nodiscard]] const std::vector<int32_t>& Solve() {
+        while (AssignColumnSingletons() || AssignFieldSingletons());
+        MatchRemaining();
+        return columnOf;
+    }
+};
+
 class TicketMaster {
     TicketAttributes attributes;
     Tickets tickets;
+    AttributeTable table;
 public:
-    explicit TicketMaster(std::istream& in) : attributes{in}, tickets{in} {}
-
-    [[nodiscard]] uint32_t SolvePart1() const noexcept {
-        auto& target = tickets.OtherTickets();
-        return std::reduce(target.begin(), target.end(), 0, [this] (auto sum, auto& ticket) {
-            auto& values = ticket.Values();
-            return sum + std::reduce(values.begin(), values.end(), 0, [this] (auto sum, auto& value) {
-               return sum + (std::ranges::none_of(attributes.Attributes(), [&value] (auto& attrib) { return attrib.IsValid(value); }) ? value : 0);
+    explicit TicketMaster(std::istream& in) : attributes{in}, tickets{in}, table{attributes} {}
+    explicit TicketMaster(CacheReader& cache) : attributes{cache}, tickets{cache}, table{attributes} {}
+
+    void Save(CacheWriter& cache) const {
+        attributes.Save(cache);
+        tickets.Save(cache);
+    }
+
+    [[nodiscard]] uint64_t SolvePart1() const {
+        auto& columns = tickets.Columns();
+        return ParallelTransformReduce(columns.begin(), columns.end(), 0ull, std::plus{}, [this] (auto& column) {
+            return ParallelTransformReduce(column.begin(), column.end(), 0ull, std::plus{}, [this] (auto value) {
+                return table.IsValid(value) ? 0ull : value;
             });
         });
     }
 
-    [[nodiscard]] uint64_t SolvePart2() noexcept {
-        tickets.DiscardInvalid(attributes);
-        std::unordered_map<int8_t, const Attribute*> unknownIndexes, knownIndexes;
-        for (auto i = 0; i < tickets.MyTicket().Values().size(); ++i)
-            unknownIndexes.emplace(i, &attributes.Attributes()[i]);
-        while (!unknownIndexes.empty()) {
-            for (auto& attr : unknownIndexes) {
-                auto idx = tickets.ValidIndexForAttribute(*attr.second, unknownIndexes);
-                if (idx != -1) {
-                    knownIndexes[idx] = attr.second;
-                    unknownIndexes[attr.first] = unknownIndexes[idx];
-                    unknownIndexes.erase(idx);
-                    break;
-                }
-            }
-        }
+    [[nodiscard]] uint64_t SolvePart2() {
+        tickets.DiscardInvalid(table);
+        auto& attribs = attributes.Attributes();
+        FieldAssignment assignment{tickets.CandidateMatrix(table), attribs.size(), table.Words()};
+        auto& columnOf = assignment.Solve();
         auto& values = tickets.MyTicket().Values();
-        return std::reduce(knownIndexes.begin(), knownIndexes.end(), 1ull, [&values] (auto sum, auto& attrib) {
-            return sum * (attrib.second->Name().find("departure") == 0 ? values[attrib.first] : 1);
-        });
+        uint64_t product = 1;
+        for (size_t field = 0; field < attribs.size(); ++field) {
+            if (attribs[field].Name().find("departure") == 0)
+                product *= values[columnOf[field]];
+        }
+        return product;
     }
 };
 
 int main(int argc, const char* argv[]) {
     if (argc != 2)
         return 1;
-    std::ifstream file{argv[1]};
-    TicketMaster tm{file};
+    AOC_ALLOC_PHASE("parse");
+    InputCache cache{argv[1], "day16", 1};
+    auto cached = cache.Open();
+    // The input itself is only opened on a miss.
+    TicketMaster tm = cached ? TicketMaster{*cached} : [input = argv[1]] {
+        InputStream file{input};
+        return TicketMaster{file};
+    }();
+    if (!cached)
+        cache.Store(tm);
+    AOC_ALLOC_PHASE("part1");
     std::cout << tm.SolvePart1() << '\n';
+    AOC_ALLOC_PHASE("part2");
     std::cout << tm.SolvePart2() << '\n';
     return 0;
 }
\ No newline at end of file
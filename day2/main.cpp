@@ -1,9 +1,12 @@
 #include <algorithm>
-#include <fstream>
 #include <iostream>
-#include <string>
 #include <string_view>
 
+#include "common/alloc_profile.h"
+#include "common/parse.h"
+#include "common/pipeline.h"
+#include "common/stream_input.h"
+
 class PasswordPolicy {
     unsigned int min;
     unsigned int max;
@@ -21,27 +24,44 @@ public:
     }
 };
 
-int main(int argc, const char* argv[]) {
-    if (argc != 2)
-        return 1;
-    std::ifstream file{argv[1]};
-    auto totalValid = 0, totalValid2 = 0;
-    while (file) {
-        unsigned int min, max;
-        char chr;
-        file >> min;
-        file.ignore(1);
-        file >> max;
-        file.ignore(1);
-        file >> chr;
-        file.ignore(2);
-        std::string password;
-        std::getline(file, password);
+// Checks each line against its policy for both parts.
+struct PasswordCheck {
+    struct Result {
+        unsigned valid = 0;
+        unsigned valid2 = 0;
+
+        Result& operator+=(const Result& rhs) noexcept {
+            valid += rhs.valid;
+            valid2 += rhs.valid2;
+            return *this;
+        }
+    };
+
+    // Lines which don't read "<min>-<max> <c>: <password>" are skipped.
+    void operator()(std::string_view line, Result& result) const noexcept {
+        unsigned int min = 0, max = 0;
+        const auto* end = line.data() + line.size();
+        const auto [dash, minError] = ParseInt(line.data(), end, min);
+        if (minError != std::errc{} || end - dash < 2)
+            return;
+        const auto [pos, maxError] = ParseInt(dash + 1, end, max);
+        if (maxError != std::errc{} || end - pos < 4)
+            return;
+        const auto chr = pos[1];
+        const std::string_view password{pos + 4, end};
         PasswordPolicy policy{min, max, chr};
         if (policy.IsValid(password))
-            ++totalValid;
+            ++result.valid;
         if (policy.IsValid2(password))
-            ++totalValid2;
+            ++result.valid2;
     }
-    std::cout << totalValid << '\n' << totalValid2 << '\n';
+};
+
+int main(int argc, const char* argv[]) {
+    if (argc != 2)
+        return 1;
+    AOC_ALLOC_PHASE("solve"); // each line is parsed and checked for both parts in one pass
+    InputStream file{argv[1]};
+    const auto result = RunPipeline(Records(file, "\n"), PasswordCheck{});
+    std::cout << result.valid << '\n' << result.valid2 << '\n';
 }
\ No newline at end of file
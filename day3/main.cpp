@@ -1,9 +1,19 @@
+#include <algorithm>
 #include <compare>
+#include <cstddef>
 #include <cstdint>
-#include <fstream>
 #include <iostream>
+#include <memory_resource>
 #include <set>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#include "common/alloc_profile.h"
+#include "common/arena.h"
+#include "common/serve.h"
+#include "common/stream_input.h"
 
 struct Point {
     int x;
@@ -16,33 +26,47 @@ struct Point {
 };
 
 class SparseMap {
-    std::set<Point> trees;
+    // Roughly a quarter of the cells are trees, at one tree node (~40 bytes) each.
+    static constexpr size_t arenaBytesPerInputByte = 10;
+
+    ParseArena arena;
+    std::pmr::set<Point> trees{&arena};
     int xLen;
     int yLen;
 public:
-    explicit SparseMap(std::istream& in) {
+    explicit SparseMap(std::istream& in) : arena{in, arenaBytesPerInputByte} {
         std::string line;
         for (auto y = 0; std::getline(in, line); ++y) {
+            xLen = line.size();
             for (auto x = 0; x < line.size(); ++x) {
                 if (line[x] == '#') {
                     trees.emplace(x, y);
                 }
             }
         }
-        xLen = line.size();
         yLen = trees.rbegin()->y + 1;
     }
 
+    [[nodiscard]] constexpr int XLen() const noexcept {
+        return xLen;
+    }
+
     [[nodiscard]] constexpr int YLen() const noexcept {
         return yLen;
     }
 
-    [[nodiscard]] constexpr bool IsOccupied(Point p) const noexcept {
+    template <class Func>
+    void ForEachTree(Func&& func) const {
+        for (auto& tree : trees)
+            func(tree);
+    }
+
+    [[nodiscard]] bool IsOccupied(Point p) const noexcept {
         p.x %= xLen;
         return trees.contains(p);
     }
 
-    [[nodiscard]] constexpr uint64_t CountCollisions(int xInc, int yInc) const noexcept {
+    [[nodiscard]] uint64_t CountCollisions(int xInc, int yInc) const noexcept {
         auto count = 0;
         for (auto y = yInc, x = xInc; y < YLen(); y += yInc, x += xInc) {
             if (IsOccupied({x, y}))
@@ -52,13 +76,65 @@ public:
     }
 };
 
+// Collision counts for a server, worked out at startup. Right only matters modulo the map's width, so every slope
+// with a down of up to precomputedDown is counted up front; steeper slopes visit few enough rows to walk them per
+// query, on a dense copy of the map rather than the tree set.
+class SlopeCounts {
+    static constexpr int precomputedDown = 64;
+
+    int xLen;
+    int yLen;
+    std::vector<uint8_t> grid; // row-major, 1 for a tree
+    std::vector<uint64_t> counts; // indexed by (down - 1) * xLen + right
+
+    [[nodiscard]] uint64_t Walk(int right, int down) const noexcept {
+        uint64_t count = 0;
+        for (auto y = down, x = right; y < yLen; y += down, x = (x + right) % xLen)
+            count += grid[static_cast<size_t>(y) * xLen + x];
+        return count;
+    }
+public:
+    explicit SlopeCounts(const SparseMap& map) : xLen{map.XLen()}, yLen{map.YLen()},
+                                                 grid(static_cast<size_t>(xLen) * yLen) {
+        map.ForEachTree([this] (const Point& tree) { grid[static_cast<size_t>(tree.y) * xLen + tree.x] = 1; });
+        for (auto down = 1; down <= std::min(precomputedDown, yLen); ++down) {
+            for (auto right = 0; right < xLen; ++right)
+                counts.push_back(Walk(right, down));
+        }
+    }
+
+    [[nodiscard]] uint64_t CountCollisions(int right, int down) const noexcept {
+        right %= xLen;
+        if (down <= std::min(precomputedDown, yLen))
+            return counts[static_cast<size_t>(down - 1) * xLen + right];
+        return Walk(right, down);
+    }
+};
+
+// Answers "<right> <down>" with the trees hit on that slope.
+[[noreturn]] void Serve(const char* socketPath, const char* input) {
+    InputStream file{input};
+    const SlopeCounts slopes{SparseMap{file}};
+    QueryServer{[&slopes] (const QueryWords& words) {
+        const auto [right, down] = QueryInts<int, 2>(words, "<right> <down>");
+        if (right < 0 || down < 1)
+            throw std::invalid_argument{"the slope must go right and down"};
+        return std::to_string(slopes.CountCollisions(right, down));
+    }}.Run(socketPath);
+}
+
 int main(int argc, const char* argv[]) {
+    if (argc == 4 && std::string_view{argv[1]} == "--serve")
+        Serve(argv[2], argv[3]);
     if (argc != 2)
         return 1;
-    std::ifstream file{argv[1]};
+    AOC_ALLOC_PHASE("parse");
+    InputStream file{argv[1]};
     const SparseMap map{file};
+    AOC_ALLOC_PHASE("part1");
     auto part1 = map.CountCollisions(3, 1);
     std::cout << part1 << '\n';
+    AOC_ALLOC_PHASE("part2");
     auto part2 = part1 *
                  map.CountCollisions(1, 1) *
                  map.CountCollisions(5, 1) *
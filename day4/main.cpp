@@ -1,16 +1,20 @@
 #include <algorithm>
-#include <fstream>
+#include <array>
 #include <iostream>
 #include <string>
 #include <string_view>
-#include <unordered_map>
+
+#include "common/alloc_profile.h"
+#include "common/flat_hash.h"
+#include "common/parse.h"
+#include "common/stream_input.h"
 
 class Passport {
-    using CharKeys = std::initializer_list<const char[4]>;
+    using CharKeys = std::array<const char*, 7>;
     static constexpr CharKeys requiredFields = {"byr", "iyr", "eyr", "hgt", "hcl", "ecl", "pid"};
     static constexpr CharKeys validEyes = {"amb", "blu", "brn", "gry", "grn", "hzl", "oth"};
 
-    std::unordered_map<std::string, std::string> attrs;
+    FlatHashMap<std::string, std::string> attrs;
 
     [[nodiscard]] constexpr static size_t FindEnd(const std::string& line, int offset) {
         auto end = line.find(' ', offset);
@@ -37,8 +41,8 @@ class Passport {
 
     [[nodiscard]] bool ValidateInt(const char key[4], const int min, const int max) const noexcept {
         return ValidateKey(key, [min, max] (auto& str) {
-            auto val = std::atoi(str.c_str());
-            return val >= min && val <= max;
+            auto val = ToInt<int>(str);
+            return val && *val >= min && *val <= max;
         });
     }
 
@@ -47,7 +51,7 @@ class Passport {
             if (hgt.size() < 4)
                 return false;
             auto unit = std::string_view{hgt}.substr(hgt.size() - 2);
-            auto len = std::atoi(hgt.substr(0, hgt.size() - 2).c_str());
+            auto len = ToInt<int>(std::string_view{hgt}.substr(0, hgt.size() - 2)).value_or(0);
             return (unit == "cm" && len > 149 && len < 194) || (unit == "in" && len > 58 && len < 77);
         });
     }
@@ -93,7 +97,8 @@ public:
 int main(int argc, const char* argv[]) {
     if (argc != 2)
         return 1;
-    std::ifstream file{argv[1]};
+    AOC_ALLOC_PHASE("solve"); // each passport is parsed and checked for both parts in one pass
+    InputStream file{argv[1]};
     auto part1 = 0, part2 = 0;
     while (file) {
         Passport passport{file};
@@ -1,10 +1,13 @@
+#include <bitset>
+#include <compare>
 #include <cstdint>
-#include <fstream>
 #include <iostream>
-#include <set>
-#include <string>
+#include <stdexcept>
 #include <string_view>
-#include <utility>
+
+#include "common/alloc_profile.h"
+#include "common/pipeline.h"
+#include "common/stream_input.h"
 
 class Seat {
     uint16_t id_;
@@ -34,6 +37,13 @@ public:
     explicit constexpr Seat(std::string_view pos) noexcept : id_{GetID(pos)} {}
     constexpr Seat(uint16_t id) noexcept : id_{id} {}
 
+    // Whether pos reads as 7 row halvings then 3 column halvings, and so names a seat.
+    [[nodiscard]] static constexpr bool IsPass(std::string_view pos) noexcept {
+        return pos.size() == 10 &&
+               pos.find_first_not_of("FB") == 7 &&
+               pos.find_first_not_of("LR", 7) == std::string_view::npos;
+    }
+
     [[nodiscard]] unsigned ID() const noexcept {
         return id_;
     }
@@ -41,22 +51,47 @@ public:
     std::strong_ordering operator<=>(const Seat&) const noexcept = default;
 };
 
-[[nodiscard]] uint16_t FindSeat(const std::set<Seat>& seats) {
+// Marks each boarding pass's seat as taken.
+struct SeatCheck {
+    struct Result {
+        std::bitset<128 * 8> taken;
+
+        Result& operator+=(const Result& rhs) noexcept {
+            taken |= rhs.taken;
+            return *this;
+        }
+    };
+
+    // Lines which aren't a boarding pass are skipped.
+    void operator()(std::string_view pass, Result& result) const noexcept {
+        if (Seat::IsPass(pass))
+            result.taken[Seat{pass}.ID()] = true;
+    }
+};
+
+[[nodiscard]] uint16_t FindSeat(const SeatCheck::Result& seats) {
     for (auto pos = 9; pos < 127 * 8; ++pos) {
-        if (!seats.contains(pos) && seats.contains(pos - 1) && seats.contains(pos + 1))
+        if (!seats.taken[pos] && seats.taken[pos - 1] && seats.taken[pos + 1])
             return pos;
     }
     throw std::runtime_error{"No Seat found for part 2."};
 }
 
+[[nodiscard]] unsigned HighestSeat(const SeatCheck::Result& seats) noexcept {
+    auto pos = seats.taken.size();
+    while (pos > 0 && !seats.taken[pos - 1])
+        --pos;
+    return pos - 1;
+}
+
 int main(int argc, const char* argv[]) {
     if (argc != 2)
         return 0;
-    std::set<Seat> seats;
-    std::ifstream file{argv[1]};
-    std::string line;
-    while (std::getline(file, line))
-        seats.emplace(line);
-    std::cout << seats.rbegin()->ID() << '\n';
+    AOC_ALLOC_PHASE("parse");
+    InputStream file{argv[1]};
+    const auto seats = RunPipeline(Records(file, "\n"), SeatCheck{});
+    AOC_ALLOC_PHASE("part1");
+    std::cout << HighestSeat(seats) << '\n';
+    AOC_ALLOC_PHASE("part2");
     std::cout << FindSeat(seats) << '\n';
 }
\ No newline at end of file
@@ -1,47 +1,72 @@
 #include <algorithm>
+#include <bit>
 #include <cstdint>
-#include <fstream>
 #include <iostream>
-#include <numeric>
-#include <string>
-#include <unordered_map>
-#include <unordered_set>
-#include <vector>
+#include <string_view>
+
+#include "common/alloc_profile.h"
+#include "common/pipeline.h"
+#include "common/stream_input.h"
 
 class Group {
-    std::unordered_map<char, uint8_t> answered;
-    uint8_t total = 0;
+    // Bit n stands for question 'a' + n.
+    uint32_t anyone = 0;
+    uint32_t everyone = 0;
 public:
-    explicit Group(std::istream& in) {
-        std::string line;
-        while (std::getline(in, line) && !line.empty()) {
-            ++total;
-            std::unordered_set<char> resps;
-            for (auto c : line)
-                resps.emplace(c);
-            for (auto& c : resps)
-                ++answered[c];
+    // One line of answers per person. Empty lines, such as the leftover of an extra blank line between groups,
+    // aren't anyone.
+    explicit Group(std::string_view record) noexcept {
+        bool first = true;
+        while (!record.empty()) {
+            const auto end = std::min(record.find('\n'), record.size());
+            if (end > 0) {
+                uint32_t person = 0;
+                for (auto c : record.substr(0, end)) {
+                    if (c >= 'a' && c <= 'z')
+                        person |= 1u << (c - 'a');
+                }
+                anyone |= person;
+                everyone = first ? person : everyone & person;
+                first = false;
+            }
+            record.remove_prefix(std::min(end + 1, record.size()));
         }
     }
 
-    friend unsigned operator+(unsigned a, const Group& b) {
-        return a + b.answered.size();
+    [[nodiscard]] unsigned AnsweredByAnyone() const noexcept {
+        return std::popcount(anyone);
+    }
+
+    [[nodiscard]] unsigned AnsweredByEveryone() const noexcept {
+        return std::popcount(everyone);
     }
+};
+
+// Totals each group's answers for both parts.
+struct GroupCheck {
+    struct Result {
+        unsigned anyone = 0;
+        unsigned everyone = 0;
+
+        Result& operator+=(const Result& rhs) noexcept {
+            anyone += rhs.anyone;
+            everyone += rhs.everyone;
+            return *this;
+        }
+    };
 
-    friend unsigned long operator+(unsigned long a, const Group& b) {
-        return a + std::ranges::count_if(b.answered, [t = b.total] (auto& kvp) { return kvp.second == t; });
+    void operator()(std::string_view record, Result& result) const noexcept {
+        const Group group{record};
+        result.anyone += group.AnsweredByAnyone();
+        result.everyone += group.AnsweredByEveryone();
     }
 };
 
 int main(int argc, const char* argv[]) {
     if (argc != 2)
         return 1;
-    std::vector<Group> groups;
-    std::ifstream file{argv[1]};
-    while (file)
-        groups.emplace_back(file);
-    // Overly clever overload matching. Don't do this outside of toy code.
-    // Fails to compile with libstdc++ until https://gcc.gnu.org/bugzilla/show_bug.cgi?id=95833 is fixed.
-    std::cout << std::reduce(groups.begin(), groups.end(), 0u) << '\n';
-    std::cout << std::reduce(groups.begin(), groups.end(), 0ul) << '\n';
+    AOC_ALLOC_PHASE("solve"); // groups are parsed and counted as they're read
+    InputStream file{argv[1]};
+    const auto result = RunPipeline(Records(file, "\n\n"), GroupCheck{});
+    std::cout << result.anyone << '\n' << result.everyone << '\n';
 }
\ No newline at end of file
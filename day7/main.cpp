@@ -1,24 +1,42 @@
 #include <algorithm>
 #include <cstdint>
-#include <fstream>
+#include <functional>
 #include <iostream>
+#include <memory_resource>
 #include <numeric>
+#include <span>
+#include <stdexcept>
 #include <string>
-#include <unordered_map>
-#include <unordered_set>
+#include <string_view>
 #include <utility>
+#include <vector>
 
+#include "common/alloc_profile.h"
+#include "common/arena.h"
+#include "common/flat_hash.h"
+#include "common/input_cache.h"
+#include "common/parallel.h"
+#include "common/serve.h"
+#include "common/stream_input.h"
+
+// Names are interned in the owning Bags' arena, so they stay put while the bags themselves move around.
 class Bag {
-    std::string name;
-    mutable std::unordered_map<std::string, uint8_t> containedBags;
 public:
-    Bag(std::string name) : name{std::move(name)} {}
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+private:
+    std::string_view name;
+    mutable FlatHashMap<std::string_view, uint8_t, std::hash<std::string_view>, std::equal_to<std::string_view>,
+                        allocator_type> containedBags;
+public:
+    Bag(std::string_view name, const allocator_type& alloc = {}) : name{name}, containedBags{alloc} {}
+    Bag(const Bag& rhs, const allocator_type& alloc) : name{rhs.name}, containedBags{rhs.containedBags, alloc} {}
+    Bag(Bag&& rhs, const allocator_type& alloc) : name{rhs.name}, containedBags{std::move(rhs.containedBags), alloc} {}
 
-    void AddBag(const Bag& bag, uint8_t count) const {
-        containedBags.emplace(bag.name, count);
+    void AddBag(std::string_view child, uint8_t count) const {
+        containedBags.emplace(child, count);
     }
 
-    const std::string& Name() const noexcept {
+    std::string_view Name() const noexcept {
         return name;
     }
 
@@ -30,27 +48,55 @@ public:
         return name == rhs.name;
     }
 
-    bool operator!=(const std::string& name) const noexcept {
+    bool operator!=(std::string_view name) const noexcept {
         return this->name != name;
     }
 
     struct Hash {
         size_t operator()(const Bag& bag) const noexcept {
-            return std::hash<std::string>{}(bag.name);
+            return std::hash<std::string_view>{}(bag.name);
         }
     };
 };
 
 class Bags {
-    std::unordered_set<Bag, Bag::Hash> bags{594};
+    // A cached containment rule, with bags numbered in the order their names were saved.
+    struct Edge {
+        uint32_t parent;
+        uint32_t child;
+        uint32_t count;
+    };
+
+    // Names, the bag table and every bag's contents all come from here and are released together.
+    ParseArena arena;
+    FlatHashSet<Bag, Bag::Hash, std::equal_to<Bag>, Bag::allocator_type> bags{594, &arena};
+
+    // names is every bag's name run together; the cache goes on to give their lengths and then the rules.
+    Bags(CacheReader& cache, std::string_view names) : arena{names.size() * 8} {
+        auto interned = arena.Intern(names);
+        std::vector<std::string_view> byIndex;
+        for (auto length : cache.ReadSpan<uint32_t>()) {
+            byIndex.push_back(interned.substr(0, length));
+            interned.remove_prefix(length);
+        }
+        bags.reserve(byIndex.size());
+        for (auto name : byIndex)
+            bags.emplace(name);
+        for (auto& edge : cache.ReadSpan<Edge>())
+            bags.find(byIndex[edge.parent])->AddBag(byIndex[edge.child], edge.count);
+    }
 
     const Bag& AddBag(std::istream& in) {
         std::string hue, colour;
         in >> hue >> colour;
-        return *bags.emplace(std::move(hue.append(colour))).first;
+        hue.append(colour);
+        if (auto bag = bags.find(Bag{hue}); bag != bags.end())
+            return *bag;
+        return *bags.emplace(arena.Intern(hue)).first;
     }
 
-    void AddSubBags(std::istream& in, const Bag& parent) {
+    // Bags move whenever the set grows, so the parent is looked up again for each child rather than held onto.
+    void AddSubBags(std::istream& in, std::string_view parent) {
         int count;
         std::string end;
         while (true) {
@@ -61,56 +107,112 @@ class Bags {
                 return;
             }
             auto& child = AddBag(in);
-            parent.AddBag(child, count);
+            bags.find(parent)->AddBag(child.Name(), count);
             in >> end;
             if (end.back() == '.')
                 break;
         }
     }
 
-    [[nodiscard]] bool FindRecurse(const Bag& bag, const std::string& target) const noexcept {
+    [[nodiscard]] bool FindRecurse(const Bag& bag, std::string_view target) const noexcept {
         auto& children = bag.ContainedBags();
         return children.contains(target) || std::ranges::any_of(children,[this, &target] (auto& child) {
             return FindRecurse(*bags.find(child.first), target);
         });
     }
 
+    // A bag only holds a handful of kinds of bag, so this stays on the calling thread.
     [[nodiscard]] int CountRecurse(const Bag& bag, int mult = 1) const noexcept {
         auto& children = bag.ContainedBags();
-        return std::reduce(children.begin(), children.end(), 0, [this, mult] (auto a, auto& child) {
-            return a + (mult * child.second) + CountRecurse(*bags.find(child.first), mult * child.second);
+        return std::transform_reduce(children.begin(), children.end(), 0, std::plus{}, [this, mult] (auto& child) {
+            return (mult * child.second) + CountRecurse(*bags.find(child.first), mult * child.second);
         });
     }
 public:
-    explicit Bags(std::istream& in) {
+    explicit Bags(std::istream& in) : arena{in, 8} {
         std::string discard;
         while (!in.eof()) {
-            auto& bag = AddBag(in);
+            auto bag = AddBag(in).Name();
             in.seekg(14, std::ios_base::cur);
             AddSubBags(in, bag);
         }
     }
 
-    [[nodiscard]] int CountCanHold(const std::string& name) const noexcept {
-        std::unordered_set<std::string_view> validEntries{bags.size()};
+    explicit Bags(CacheReader& cache) : Bags{cache, cache.ReadString()} {}
+
+    void Save(CacheWriter& cache) const {
+        FlatHashMap<std::string_view, uint32_t> index{bags.size()};
+        std::string names;
+        std::vector<uint32_t> lengths;
         for (auto& bag : bags) {
-            if (bag != name && FindRecurse(bag, name))
-                validEntries.emplace(bag.Name());
+            index.emplace(bag.Name(), lengths.size());
+            names.append(bag.Name());
+            lengths.push_back(bag.Name().size());
         }
-        return validEntries.size();
+        std::vector<Edge> edges;
+        for (auto& bag : bags) {
+            for (auto& [child, count] : bag.ContainedBags())
+                edges.push_back({index.find(bag.Name())->second, index.find(child)->second, count});
+        }
+        cache.WriteString(names);
+        cache.WriteSpan(std::span<const uint32_t>{lengths});
+        cache.WriteSpan(std::span<const Edge>{edges});
+    }
+
+    [[nodiscard]] bool Contains(std::string_view name) const noexcept {
+        return bags.find(name) != bags.end();
+    }
+
+    // Every bag is searched on its own, so the bag table is split between threads. How far a search goes varies a
+    // lot from bag to bag, so there are a few parts per thread to even out the load.
+    [[nodiscard]] int CountCanHold(std::string_view name) const {
+        const auto parts = std::min(bags.size(), ThreadPool::Shared().Concurrency() * 4);
+        return ParallelReduce(parts, 0, std::plus{}, [this, name, parts] (size_t part) {
+            auto segment = bags.Segment(part, parts);
+            return static_cast<int>(std::ranges::count_if(segment, [this, name] (const Bag& bag) {
+                return bag != name && FindRecurse(bag, name);
+            }));
+        });
     }
 
-    [[nodiscard]] int CountHolds(const std::string& name) const noexcept {
+    [[nodiscard]] int CountHolds(std::string_view name) const noexcept {
         return CountRecurse(*bags.find(name));
     }
 };
 
+// Answers "holders <hue> <colour>" with how many bags can end up holding that one, and "contents <hue> <colour>"
+// with how many bags it has to hold.
+[[noreturn]] void Serve(const char* socketPath, const char* input) {
+    InputStream file{input};
+    const Bags bags{file};
+    QueryServer{[&bags] (const QueryWords& words) {
+        if (words.size() != 3 || (words[0] != "holders" && words[0] != "contents"))
+            throw std::invalid_argument{"expected <holders|contents> <hue> <colour>"};
+        const auto name = std::string{words[1]}.append(words[2]);
+        if (!bags.Contains(name))
+            throw std::invalid_argument{"no such bag"};
+        return std::to_string(words[0] == "holders" ? bags.CountCanHold(name) : bags.CountHolds(name));
+    }}.Run(socketPath);
+}
+
 int main(int argc, const char* argv[]) {
+    if (argc == 4 && std::string_view{argv[1]} == "--serve")
+        Serve(argv[2], argv[3]);
     if (argc != 2)
         return 1;
-    std::ifstream file{argv[1]};
-    Bags bags{file};
+    AOC_ALLOC_PHASE("parse");
+    InputCache cache{argv[1], "day7", 1};
+    auto cached = cache.Open();
+    // The input itself is only opened on a miss.
+    Bags bags = cached ? Bags{*cached} : [input = argv[1]] {
+        InputStream file{input};
+        return Bags{file};
+    }();
+    if (!cached)
+        cache.Store(bags);
+    AOC_ALLOC_PHASE("part1");
     std::cout << bags.CountCanHold("shinygold") << '\n';
+    AOC_ALLOC_PHASE("part2");
     std::cout << bags.CountHolds("shinygold") << '\n';
     return 0;
 }
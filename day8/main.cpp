@@ -1,10 +1,18 @@
 #include <algorithm>
 #include <cstdint>
-#include <fstream>
 #include <iostream>
-#include <unordered_set>
+#include <span>
+#include <string>
+#include <string_view>
 #include <vector>
 
+#include "common/alloc_profile.h"
+#include "common/flat_hash.h"
+#include "common/input_cache.h"
+#include "common/instrument.h"
+#include "common/parse.h"
+#include "common/stream_input.h"
+
 enum class OpCode {
     ACC,
     JMP,
@@ -25,6 +33,7 @@ public:
     explicit TuringMachine(std::vector<Op>&& insns) noexcept : insns{std::move(insns)} {}
 
     void ExecClockCycle() noexcept {
+        AOC_COUNT("day8.ExecClockCycle");
         auto& op = insns[ip++];
         switch (op.code) {
             case OpCode::ACC:
@@ -65,9 +74,12 @@ class Simulator {
     [[nodiscard]] static std::vector<Op> InitMachine(std::istream& in) {
         std::vector<Op> ret;
         ret.reserve(623);
-        std::string op;
-        int arg;
-        while (in >> op >> arg) {
+        std::string line;
+        while (std::getline(in, line)) {
+            int arg;
+            if (line.size() < 5 || ParseInt(line.data() + 4, line.data() + line.size(), arg).ec != std::errc{})
+                continue;
+            const std::string_view op{line.data(), 3};
             if (op == "jmp")
                 ret.emplace_back(OpCode::JMP, arg);
             else if (op == "acc")
@@ -92,20 +104,31 @@ class Simulator {
     }
 public:
     explicit Simulator(std::istream& in) : tm{InitMachine(in)} {}
+    explicit Simulator(CacheReader& cache) : tm{[&cache] {
+        auto insns = cache.ReadSpan<Op>();
+        return std::vector<Op>(insns.begin(), insns.end());
+    }()} {}
+
+    void Save(CacheWriter& cache) const {
+        cache.WriteSpan(std::span{tm.Insns()});
+    }
 
     [[nodiscard]] uint32_t GetAccOnFirstRepetition() noexcept {
-        std::unordered_set<uint32_t> visited;
+        FlatHashSet<uint32_t> visited;
         while (tm.IP() < tm.Insns().size() && !visited.contains(tm.IP())) {
             visited.emplace(tm.IP());
             tm.ExecClockCycle();
         }
+        AOC_HISTOGRAM("day8.cyclesPerRun", visited.size());
         return tm.Acc();
     }
 
     [[nodiscard]] uint32_t FindAndFix() noexcept {
-        uint32_t lastChangePos = 0, acc;
+        AOC_TIME_SCOPE("day8.FindAndFix");
+        uint32_t lastChangePos = 0, acc = 0;
         auto& insns = tm.Insns();
         while (tm.IP() != insns.size()) {
+            AOC_COUNT("day8.FindAndFix.swaps");
             lastChangePos = TryInsnSwap(lastChangePos);
             tm.Reset();
             acc = GetAccOnFirstRepetition();
@@ -117,8 +140,18 @@ public:
 int main(int argc, const char* argv[]) {
     if (argc != 2)
         return 1;
-    std::ifstream file{argv[1]};
-    Simulator sim{file};
+    AOC_ALLOC_PHASE("parse");
+    InputCache cache{argv[1], "day8", 1};
+    auto cached = cache.Open();
+    // The input itself is only opened on a miss.
+    Simulator sim = cached ? Simulator{*cached} : [input = argv[1]] {
+        InputStream file{input};
+        return Simulator{file};
+    }();
+    if (!cached)
+        cache.Store(sim);
+    AOC_ALLOC_PHASE("part1");
     std::cout << sim.GetAccOnFirstRepetition() << '\n';
+    AOC_ALLOC_PHASE("part2");
     std::cout << sim.FindAndFix() << '\n';
 }
\ No newline at end of file
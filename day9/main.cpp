@@ -1,9 +1,13 @@
 #include <algorithm>
-#include <fstream>
 #include <iostream>
-#include <unordered_set>
 #include <vector>
 
+#include "common/alloc_profile.h"
+#include "common/flat_hash.h"
+#include "common/instrument.h"
+#include "common/parse.h"
+#include "common/stream_input.h"
+
 template <size_t N>
 constexpr int32_t permutations = (N * (N - 1)) / 2;
 
@@ -32,30 +36,35 @@ public:
 template <size_t N>
 class XMASCipher {
     std::vector<NumberSum<N>> data;
-    std::unordered_multiset<int64_t> sumsSet;
+    FlatHashMap<int64_t, uint32_t> sumsSet; // value -> occurrences
 
     void ShiftStream(int32_t next) {
-        for (auto& i : data[next - N].Sums())
-            sumsSet.erase(sumsSet.find(i));
+        for (auto& i : data[next - N].Sums()) {
+            AOC_COUNT("day9.ShiftStream.erases");
+            if (auto pos = sumsSet.find(i); --pos->second == 0)
+                sumsSet.erase(pos);
+        }
         auto& nextRef = data[next];
         for (auto i = data.begin() + (next - (N - 1)); i != data.begin() + next; ++i) {
-            sumsSet.emplace(i->SumAndPush(nextRef));
+            AOC_COUNT("day9.ShiftStream.inserts");
+            ++sumsSet[i->SumAndPush(nextRef)];
         }
+        AOC_HISTOGRAM("day9.ShiftStream.distinctSums", sumsSet.size());
     }
 public:
     explicit XMASCipher(std::istream& in) {
-        int val;
-        while (in >> val)
+        for (auto val : ParseInts<int64_t>(ReadAll(in), '\n'))
             data.emplace_back(val);
         sumsSet.reserve(permutations<N>);
         for (auto i = data.begin(); i != data.begin() + N; ++i) {
             for (auto j = i + 1; j != data.begin() + N; ++j) {
-                sumsSet.emplace(i->SumAndPush(*j));
+                ++sumsSet[i->SumAndPush(*j)];
             }
         }
     }
 
     [[nodiscard]] int64_t FindFirstNonSumming() noexcept {
+        AOC_TIME_SCOPE("day9.FindFirstNonSumming");
         for (auto i = N; i < data.size(); ++i) {
             if (!sumsSet.contains(data[i]))
                 return data[i];
@@ -65,6 +74,7 @@ public:
     }
 
     [[nodiscard]] int64_t FindSumOfMinMaxMatching(const int64_t val) const noexcept {
+        AOC_TIME_SCOPE("day9.FindSumOfMinMaxMatching");
         for (auto first = 0; first < data.size(); ++first) {
             int64_t sum = data[first], min = sum, max = sum;
             for (auto last = first + 1; last < data.size(); ++last) {
@@ -85,9 +95,12 @@ public:
 int main(int argc, const char* argv[]) {
     if (argc != 2)
         return 1;
-    std::ifstream file{argv[1]};
+    AOC_ALLOC_PHASE("parse");
+    InputStream file{argv[1]};
     XMASCipher<25> cipher{file};
+    AOC_ALLOC_PHASE("part1");
     auto part1 = cipher.FindFirstNonSumming();
+    AOC_ALLOC_PHASE("part2");
     auto part2 = cipher.FindSumOfMinMaxMatching(part1);
     std::cout << part1 << '\n' << part2 << '\n';
 }
\ No newline at end of file
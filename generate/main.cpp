@@ -0,0 +1,606 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "common/parse.h"
+
+// Writes a valid puzzle input for one day at an arbitrary scale, so the solvers can be profiled well beyond the size
+// of a personal input. The same day, scale and seed always give the same bytes with a given standard library.
+// Inputs are built so that each part has a single intended answer, and like the inputs the solvers expect they have
+// no trailing newline.
+class Generator {
+    std::mt19937_64 rng;
+    std::ostream& out;
+    bool firstLine = true;
+
+    [[nodiscard]] int64_t Uniform(int64_t min, int64_t max) {
+        return std::uniform_int_distribution<int64_t>{min, max}(rng);
+    }
+
+    [[nodiscard]] bool Chance(double p) {
+        return std::bernoulli_distribution{p}(rng);
+    }
+
+    template <class Container>
+    void Shuffle(Container& items) {
+        std::ranges::shuffle(items, rng);
+    }
+
+    // Starts a new line. The separator is written lazily so the input doesn't end with one.
+    std::ostream& Line() {
+        if (!firstLine)
+            out << '\n';
+        firstLine = false;
+        return out;
+    }
+
+    [[nodiscard]] std::string Digits(size_t count) {
+        std::string ret(count, '0');
+        for (auto& c : ret)
+            c = static_cast<char>('0' + Uniform(0, 9));
+        return ret;
+    }
+
+    // Lower-case letters spelling out n in base 26, padded with 'a' to at least width letters.
+    [[nodiscard]] static std::string Word(uint64_t n, size_t width) {
+        std::string ret;
+        for (; n > 0 || ret.size() < width; n /= 26)
+            ret.push_back(static_cast<char>('a' + n % 26));
+        return ret;
+    }
+
+    static void Require(bool condition, const char* message) {
+        if (!condition)
+            throw std::invalid_argument{message};
+    }
+
+    // One pair and one triple sum to 2020. Everything else lies in [1011, 2019] and avoids completing either with
+    // the planted numbers, so the filler is all checked and rejected.
+    void Day1(size_t scale) {
+        Require(scale >= 5, "Day 1 needs a scale of at least 5.");
+        int x, y, z;
+        do {
+            x = Uniform(500, 700), y = Uniform(500, 700), z = 2020 - x - y;
+        } while (z > 1009);
+        const int a = Uniform(1, 499);
+        const std::array small = {a, x, y, z};
+        std::vector<bool> forbidden(2021);
+        for (size_t i = 0; i < small.size(); ++i) {
+            forbidden[2020 - small[i]] = true;
+            for (auto j = i + 1; j < small.size(); ++j)
+                forbidden[2020 - small[i] - small[j]] = true;
+        }
+        std::vector<int> values{a, 2020 - a, x, y, z};
+        values.reserve(scale);
+        while (values.size() < scale) {
+            if (auto filler = Uniform(1011, 2019); !forbidden[filler])
+                values.push_back(filler);
+        }
+        Shuffle(values);
+        for (auto value : values)
+            Line() << value;
+    }
+
+    void Day2(size_t scale) {
+        for (size_t i = 0; i < scale; ++i) {
+            const auto min = Uniform(1, 10), max = Uniform(min + 1, min + 10);
+            // A narrow alphabet makes the policy letter common enough for both outcomes to occur.
+            const auto chr = static_cast<char>('a' + Uniform(0, 5));
+            std::string password(Uniform(max, max + 10), ' ');
+            for (auto& c : password)
+                c = static_cast<char>('a' + Uniform(0, 5));
+            Line() << min << '-' << max << ' ' << chr << ": " << password;
+        }
+    }
+
+    // scale rows of the usual 31 column slope.
+    void Day3(size_t scale) {
+        std::string row(31, '.');
+        for (size_t y = 0; y < scale; ++y) {
+            for (auto& c : row)
+                c = Chance(0.25) ? '#' : '.';
+            Line() << row;
+        }
+    }
+
+    // Fields go missing or out of range often enough that each part filters out a different subset.
+    void Day4(size_t scale) {
+        static constexpr std::array<std::string_view, 9> eyes = {"amb", "blu", "brn", "gry", "grn", "hzl", "oth",
+                                                                 "xry", "zzz"};
+        static constexpr std::string_view hex = "0123456789abcdefz";
+        std::vector<std::string> fields;
+        for (size_t i = 0; i < scale; ++i) {
+            fields.clear();
+            const auto add = [this, &fields] (std::string_view key, const std::string& value, double p = 0.9) {
+                if (Chance(p))
+                    fields.push_back(std::string{key} + ':' + value);
+            };
+            add("byr", std::to_string(Uniform(1900, 2010)));
+            add("iyr", std::to_string(Uniform(2005, 2025)));
+            add("eyr", std::to_string(Uniform(2015, 2035)));
+            const auto cm = Chance(0.5);
+            add("hgt", std::to_string(cm ? Uniform(140, 200) : Uniform(50, 85)) + (Chance(0.9) ? (cm ? "cm" : "in") : ""));
+            std::string hcl = Chance(0.9) ? "#" : "";
+            for (auto j = 0; j < 6; ++j)
+                hcl.push_back(hex[Chance(0.98) ? Uniform(0, 15) : 16]);
+            add("hcl", hcl);
+            add("ecl", std::string{eyes[Uniform(0, Chance(0.9) ? 6 : eyes.size() - 1)]});
+            add("pid", Digits(Chance(0.9) ? 9 : Uniform(8, 10)));
+            add("cid", std::to_string(Uniform(100, 350)), fields.empty() ? 1 : 0.5);
+            Shuffle(fields);
+            if (i > 0)
+                Line();
+            for (size_t j = 0; j < fields.size();) {
+                auto& line = Line();
+                const auto end = std::min<size_t>(j + Uniform(1, 4), fields.size());
+                for (const auto first = j; j < end; ++j)
+                    line << (j == first ? "" : " ") << fields[j];
+            }
+        }
+    }
+
+    // Seat IDs are ten bits, so this is a run of scale + 1 consecutive seats with one missing from the middle.
+    void Day5(size_t scale) {
+        Require(scale >= 3 && scale <= 1000, "Day 5 needs a scale between 3 and 1000.");
+        const auto first = Uniform(8, 1016 - scale);
+        const auto missing = Uniform(first + 1, first + scale - 1);
+        std::vector<int> ids;
+        for (auto id = first; id <= first + static_cast<int64_t>(scale); ++id) {
+            if (id != missing)
+                ids.push_back(id);
+        }
+        Shuffle(ids);
+        for (auto id : ids) {
+            std::string pass(10, ' ');
+            for (auto bit = 0; bit < 10; ++bit)
+                pass[9 - bit] = bit < 3 ? (id >> bit & 1 ? 'R' : 'L') : (id >> bit & 1 ? 'B' : 'F');
+            Line() << pass;
+        }
+    }
+
+    // Each group shares some answers and each person adds a few of their own.
+    void Day6(size_t scale) {
+        std::array<bool, 26> common;
+        std::string person;
+        for (size_t i = 0; i < scale; ++i) {
+            if (i > 0)
+                Line();
+            for (auto& c : common)
+                c = Chance(0.2);
+            for (auto people = Uniform(1, 5); people > 0; --people) {
+                person.clear();
+                for (auto c = 0; c < 26; ++c) {
+                    if (common[c] || Chance(0.1))
+                        person.push_back(static_cast<char>('a' + c));
+                }
+                if (person.empty())
+                    person.push_back(static_cast<char>('a' + Uniform(0, 25)));
+                Shuffle(person);
+                Line() << person;
+            }
+        }
+    }
+
+    // The rules form a layered DAG with shiny gold in the third of six layers, so part 1 sees everything above it
+    // and part 2 a bounded tree below. Each bag holds between one and three bags of the next layer down.
+    void Day7(size_t scale) {
+        static constexpr size_t layers = 6, goldLayer = 2;
+        static constexpr std::array<std::string_view, 16> colours = {
+            "aqua", "beige", "black", "blue", "bronze", "coral", "crimson", "cyan",
+            "fuchsia", "green", "indigo", "lime", "maroon", "olive", "plum", "teal"};
+        Require(scale >= 2 * layers, "Day 7 needs a scale of at least 12.");
+        Require(scale <= 26 * 26 * 26 * 26 * colours.size(), "Day 7 supports at most 7311616 colours.");
+        // The hues all start with 'q' and have the same length, so no two names run together the same way and
+        // none is shiny gold.
+        const auto name = [] (size_t bag) {
+            return 'q' + Word(bag / colours.size(), 4) + ' ' + std::string{colours[bag % colours.size()]};
+        };
+        std::vector<size_t> order(scale);
+        std::iota(order.begin(), order.end(), 0);
+        Shuffle(order);
+        const auto layerBegin = [scale] (size_t layer) { return scale * layer / layers; };
+        const auto gold = order[layerBegin(goldLayer)];
+        std::vector<std::string> names(scale);
+        for (size_t i = 0; i < scale; ++i)
+            names[i] = i == gold ? "shiny gold" : name(i);
+        std::vector<std::string> rules;
+        rules.reserve(scale);
+        for (size_t layer = 0; layer < layers; ++layer) {
+            const auto begin = layerBegin(layer), end = layerBegin(layer + 1);
+            for (auto i = begin; i < end; ++i) {
+                auto rule = names[order[i]] + " bags contain ";
+                if (layer + 1 == layers) {
+                    rules.push_back(rule + "no other bags.");
+                    continue;
+                }
+                const auto next = layerBegin(layer + 1), size = layerBegin(layer + 2) - next;
+                std::vector<size_t> children;
+                for (auto n = std::min<int64_t>(Uniform(1, 3), size); children.size() < static_cast<size_t>(n);) {
+                    // The first bag above shiny gold always holds it, so part 1 is never empty.
+                    const auto child = layer + 1 == goldLayer && i == begin && children.empty() ?
+                                       next : next + Uniform(0, size - 1);
+                    if (std::ranges::find(children, child) == children.end())
+                        children.push_back(child);
+                }
+                for (size_t c = 0; c < children.size(); ++c) {
+                    const auto count = Uniform(1, 5);
+                    rule += std::to_string(count) + ' ' + names[order[children[c]]] + (count == 1 ? " bag" : " bags") +
+                            (c + 1 == children.size() ? "." : ", ");
+                }
+                rules.push_back(std::move(rule));
+            }
+        }
+        Shuffle(rules);
+        for (auto& rule : rules)
+            Line() << rule;
+    }
+
+    // Execution runs forwards until one jmp sends it back, and swapping that jmp is the only fix. Before it, jmps
+    // only skip ahead to at most the loop and nops point backwards or at themselves, so no other swap can escape;
+    // after it, control only moves forwards to the end.
+    void Day8(size_t scale) {
+        Require(scale >= 3, "Day 8 needs a scale of at least 3.");
+        const auto loop = Uniform(scale / 2, scale - 2);
+        for (int64_t i = 0; i < static_cast<int64_t>(scale); ++i) {
+            auto& line = Line();
+            if (i == loop) {
+                line << "jmp -" << Uniform(1, std::min<int64_t>(loop, 50));
+                continue;
+            }
+            const auto limit = i < loop ? loop : static_cast<int64_t>(scale);
+            switch (Uniform(0, 3)) {
+                case 0:
+                case 1: {
+                    const auto arg = Uniform(-50, 50);
+                    line << "acc " << (arg < 0 ? "" : "+") << arg;
+                    break;
+                }
+                case 2:
+                    line << "jmp +" << Uniform(1, std::min<int64_t>(limit - i, 4));
+                    break;
+                default:
+                    if (i < loop)
+                        line << "nop -" << Uniform(0, std::min<int64_t>(i, 50));
+                    else
+                        line << "nop +" << Uniform(0, 50);
+            }
+        }
+    }
+
+    // The first 25 numbers are small, and every later one is the sum of two of the smallest in its window, which
+    // keeps growth as slow as possible: even so the window minimum doubles roughly every 25 numbers, so int64
+    // overflows after about 1400 of them. The odd one out is the sum of a run near the start, which is far smaller
+    // than any pair in its window.
+    void Day9(size_t scale) {
+        static constexpr size_t preamble = 25;
+        Require(scale >= 2 * preamble + 2, "Day 9 needs a scale of at least 52.");
+        std::vector<int64_t> values;
+        values.reserve(scale);
+        for (size_t i = 0; i < preamble; ++i)
+            values.push_back(Uniform(1, 50));
+        const auto invalid = static_cast<size_t>(Uniform(std::max(2 * preamble, scale * 3 / 4), scale - 1));
+        std::array<int64_t, preamble> window;
+        while (values.size() < scale) {
+            std::copy(values.end() - preamble, values.end(), window.begin());
+            if (values.size() == invalid) {
+                int64_t sum;
+                do {
+                    const auto first = Uniform(0, 9), last = first + Uniform(2, 10);
+                    sum = std::accumulate(values.begin() + first, values.begin() + last, int64_t{0});
+                } while (std::ranges::any_of(window, [&window, sum] (auto a) {
+                    return std::ranges::count(window, sum - a) > (sum - a == a);
+                }));
+                values.push_back(sum);
+                continue;
+            }
+            std::ranges::partial_sort(window, window.begin() + 5);
+            const auto a = Uniform(0, 4);
+            auto b = Uniform(0, 3);
+            b += b >= a;
+            if (window[a] > std::numeric_limits<int64_t>::max() / 4)
+                throw std::invalid_argument{"Day 9 overflows int64 at " + std::to_string(values.size()) + " numbers."};
+            values.push_back(window[a] + window[b]);
+        }
+        for (auto value : values)
+            Line() << value;
+    }
+
+    // Runs of one-jolt steps of up to four, separated by three-jolt steps. Ratings are int16, which caps the count
+    // at around 16000 adapters; beyond a hundred or so the part 2 count wraps modulo 2^64.
+    void Day10(size_t scale) {
+        std::vector<int> ratings;
+        ratings.reserve(scale);
+        // The last three ratings with the number of arrangements reaching each, starting from the outlet, so that
+        // part 2's count can be kept within the solver's 64 bits.
+        std::array<std::pair<int, uint64_t>, 3> recent{{{0, 1}, {-4, 0}, {-4, 0}}};
+        for (int rating = 0, run = 0; ratings.size() < scale;) {
+            if (run == 0) {
+                rating += 3;
+                run = Uniform(1, 4);
+            } else {
+                rating += 1;
+                --run;
+            }
+            if (rating > std::numeric_limits<int16_t>::max() - 3)
+                throw std::invalid_argument{"Day 10 ratings overflow int16 at " + std::to_string(ratings.size()) +
+                                            " adapters."};
+            uint64_t arrangements = 0;
+            for (auto [previous, count] : recent) {
+                if (rating - previous > 3)
+                    continue;
+                if (count > std::numeric_limits<uint64_t>::max() - arrangements)
+                    throw std::invalid_argument{"Day 10 arrangements overflow uint64 at " +
+                                                std::to_string(ratings.size()) + " adapters."};
+                arrangements += count;
+            }
+            recent = {{{rating, arrangements}, recent[0], recent[1]}};
+            ratings.push_back(rating);
+        }
+        Shuffle(ratings);
+        for (auto rating : ratings)
+            Line() << rating;
+    }
+
+    using Block = std::vector<std::string>;
+
+    // Whether a block settles under the adjacent-seat rule, run on its own. Synchronous updates either settle or
+    // fall into a cycle, and in practice they settle within a few dozen rounds, so anything slower counts as a cycle.
+    [[nodiscard]] static bool Settles(Block state) {
+        const auto height = static_cast<int>(state.size()), width = static_cast<int>(state[0].size());
+        for (auto round = 0; round < height * width; ++round) {
+            auto next = state;
+            auto changed = false;
+            for (auto y = 0; y < height; ++y) {
+                for (auto x = 0; x < width; ++x) {
+                    if (state[y][x] == '.')
+                        continue;
+                    auto occupied = 0;
+                    for (auto ny = std::max(y - 1, 0); ny <= std::min(y + 1, height - 1); ++ny) {
+                        for (auto nx = std::max(x - 1, 0); nx <= std::min(x + 1, width - 1); ++nx)
+                            occupied += (ny != y || nx != x) && state[ny][nx] == '#';
+                    }
+                    if (state[y][x] == 'L' && occupied == 0)
+                        next[y][x] = '#', changed = true;
+                    else if (state[y][x] == '#' && occupied >= 4)
+                        next[y][x] = 'L', changed = true;
+                }
+            }
+            if (!changed)
+                return true;
+            state = std::move(next);
+        }
+        return false;
+    }
+
+    // A scale by scale seating area, three quarters of it seats, laid out as 15 by 15 blocks between single rows and
+    // columns of floor. At that density a random layout of any real size all but surely holds a cluster that
+    // empties and fills forever under the part 1 rule, so each block is checked to settle by itself; the floor
+    // keeps blocks from seeing each other under that rule. Line of sight crosses the floor, but the part 2 rule
+    // hasn't been seen to cycle on these layouts. Blocks are drawn from a small pool per size to keep generation
+    // cheap.
+    void Day11(size_t scale) {
+        static constexpr size_t blockSize = 15, poolSize = 64;
+        Require(scale <= std::numeric_limits<int16_t>::max(), "Day 11 supports at most 32767 columns.");
+        std::map<std::pair<size_t, size_t>, std::vector<Block>> pools;
+        const auto pool = [&] (size_t height, size_t width) -> const std::vector<Block>& {
+            auto& blocks = pools[{height, width}];
+            while (blocks.size() < poolSize) {
+                Block block(height, std::string(width, '.'));
+                for (auto& row : block) {
+                    for (auto& c : row)
+                        c = Chance(0.75) ? 'L' : '.';
+                }
+                if (Settles(block))
+                    blocks.push_back(std::move(block));
+            }
+            return blocks;
+        };
+        std::vector<const Block*> band;
+        for (size_t top = 0; top < scale; top += blockSize + 1) {
+            const auto height = std::min(blockSize, scale - top);
+            band.clear();
+            for (size_t left = 0; left < scale; left += blockSize + 1) {
+                auto& blocks = pool(height, std::min(blockSize, scale - left));
+                band.push_back(&blocks[Uniform(0, blocks.size() - 1)]);
+            }
+            for (size_t y = 0; y < height; ++y) {
+                auto& line = Line();
+                for (size_t b = 0, left = 0; b < band.size(); ++b, left += blockSize + 1)
+                    line << (*band[b])[y] << (left + blockSize < scale ? "." : "");
+            }
+            if (top + height < scale)
+                Line() << std::string(scale, '.');
+        }
+    }
+
+    void Day12(size_t scale) {
+        static constexpr std::string_view moves = "NSEW";
+        for (size_t i = 0; i < scale; ++i) {
+            auto& line = Line();
+            switch (Uniform(0, 3)) {
+                case 0:
+                    line << (Chance(0.5) ? 'L' : 'R') << 90 * Uniform(1, 3);
+                    break;
+                case 1:
+                    line << 'F' << Uniform(1, 100);
+                    break;
+                default:
+                    line << moves[Uniform(0, 3)] << Uniform(1, 5);
+            }
+        }
+    }
+
+    // A schedule scale slots long. The buses are distinct primes, as many as fit while the combined period stays
+    // within int64, with the first in slot 0.
+    void Day13(size_t scale) {
+        Require(scale >= 1, "Day 13 needs a scale of at least 1.");
+        std::vector<int64_t> primes;
+        for (int64_t n = 13; n < 1000; n += 2) {
+            if (std::ranges::none_of(primes, [n] (auto p) { return n % p == 0; }) && n % 3 && n % 5 && n % 7 && n % 11)
+                primes.push_back(n);
+        }
+        Shuffle(primes);
+        std::vector<int64_t> slots(scale);
+        std::vector<size_t> freeSlots(scale - 1);
+        std::iota(freeSlots.begin(), freeSlots.end(), 1);
+        Shuffle(freeSlots);
+        int64_t period = 1;
+        for (size_t bus = 0; bus < primes.size() && bus <= freeSlots.size(); ++bus) {
+            if (period > std::numeric_limits<int64_t>::max() / primes[bus])
+                break;
+            period *= primes[bus];
+            slots[bus == 0 ? 0 : freeSlots[bus - 1]] = primes[bus];
+        }
+        Line() << Uniform(100'000, 1'000'000);
+        auto& line = Line();
+        for (size_t i = 0; i < scale; ++i) {
+            line << (i ? "," : "");
+            if (slots[i])
+                line << slots[i];
+            else
+                line << 'x';
+        }
+    }
+
+    // Masks with up to nine floating bits, each followed by a handful of writes to 16-bit addresses.
+    void Day14(size_t scale) {
+        std::string mask(36, '0');
+        for (size_t i = 0; i < scale;) {
+            for (auto& c : mask)
+                c = Chance(0.5) ? '1' : '0';
+            for (auto floating = Uniform(0, 9); floating > 0; --floating)
+                mask[Uniform(0, 35)] = 'X';
+            Line() << "mask = " << mask;
+            ++i;
+            for (auto writes = Uniform(1, 6); writes > 0 && i < scale; --writes, ++i)
+                Line() << "mem[" << Uniform(0, 65535) << "] = " << Uniform(0, (1ll << 36) - 1);
+        }
+    }
+
+    // Distinct starting numbers; the turn counts are the solver's own arguments.
+    void Day15(size_t scale) {
+        Require(scale >= 1 && scale < 2020, "Day 15 needs a scale between 1 and 2019.");
+        std::vector<uint32_t> numbers(2 * scale + 10);
+        std::iota(numbers.begin(), numbers.end(), 0);
+        Shuffle(numbers);
+        numbers.resize(scale);
+        auto& line = Line();
+        for (size_t i = 0; i < scale; ++i)
+            line << (i ? "," : "") << numbers[i];
+    }
+
+    // scale fields with a staircase of valid ranges: the field of rank r accepts [base + r, base + scale - 1], and
+    // every column holds its own field's lowest value at least once, so a column accepts exactly the fields of
+    // lower or equal rank and the assignment is unique. Each field also has a second range no ticket uses, and a
+    // quarter of the nearby tickets carry a value outside every range. The departure fields come from the lowest
+    // thousand ranks with our values kept close to their minimum, so that the part 2 product fits in 64 bits.
+    void Day16(size_t scale) {
+        static constexpr int64_t base = 25;
+        static constexpr size_t departures = 6;
+        Require(scale >= 1 && scale <= 30'000, "Day 16 needs a scale between 1 and 30000.");
+        const auto fields = static_cast<int64_t>(scale);
+        const auto high = base + fields + 5;
+        // Fields 0 to 5 are the departures and draw their ranks from the low ones; the rest share what's left.
+        std::vector<int64_t> rank(fields), low(std::min<int64_t>(fields, 1000));
+        std::iota(low.begin(), low.end(), 0);
+        Shuffle(low);
+        const auto lowTaken = std::min(departures, scale);
+        std::vector<bool> taken(fields);
+        for (size_t d = 0; d < lowTaken; ++d)
+            taken[rank[d] = low[d]] = true;
+        std::vector<int64_t> rest;
+        for (int64_t r = 0; r < fields; ++r) {
+            if (!taken[r])
+                rest.push_back(r);
+        }
+        Shuffle(rest);
+        std::copy(rest.begin(), rest.end(), rank.begin() + lowTaken);
+        std::vector<size_t> order(fields);
+        std::iota(order.begin(), order.end(), 0);
+        Shuffle(order);
+        for (auto f : order) {
+            Line() << (f < departures ? "departure " : "zone ") << Word(f, 2) << ": " << base + rank[f] << '-'
+                   << base + fields - 1 << " or " << high + Uniform(0, 20) << '-' << high + 20 + Uniform(1, 40);
+        }
+        std::vector<size_t> fieldOf(fields);
+        std::iota(fieldOf.begin(), fieldOf.end(), 0);
+        Shuffle(fieldOf);
+        const auto value = [&] (size_t column, int64_t spread) {
+            const auto min = base + rank[fieldOf[column]];
+            return Uniform(min, std::min(base + fields - 1, min + spread));
+        };
+        Line();
+        Line() << "your ticket:";
+        auto& mine = Line();
+        for (size_t c = 0; c < scale; ++c)
+            mine << (c ? "," : "") << value(c, fieldOf[c] < departures ? 500 : fields);
+        Line();
+        Line() << "nearby tickets:";
+        const auto rows = std::max<size_t>(200, 4 * scale);
+        std::vector<bool> invalid(rows);
+        for (auto&& row : invalid)
+            row = Chance(0.25);
+        std::vector<size_t> lowest(scale);
+        for (auto& row : lowest) {
+            do {
+                row = Uniform(0, rows - 1);
+            } while (invalid[row]);
+        }
+        for (size_t r = 0; r < rows; ++r) {
+            const auto bad = invalid[r] ? Uniform(0, fields - 1) : -1;
+            auto& line = Line();
+            for (size_t c = 0; c < scale; ++c) {
+                line << (c ? "," : "");
+                if (static_cast<int64_t>(c) == bad)
+                    line << (Chance(0.5) ? Uniform(0, base - 1) : high + 61 + Uniform(0, 100));
+                else
+                    line << (lowest[c] == r ? base + rank[fieldOf[c]] : value(c, fields));
+            }
+        }
+    }
+public:
+    using Day = void (Generator::*)(size_t);
+    static constexpr std::array<Day, 16> days = {
+        &Generator::Day1, &Generator::Day2, &Generator::Day3, &Generator::Day4,
+        &Generator::Day5, &Generator::Day6, &Generator::Day7, &Generator::Day8,
+        &Generator::Day9, &Generator::Day10, &Generator::Day11, &Generator::Day12,
+        &Generator::Day13, &Generator::Day14, &Generator::Day15, &Generator::Day16};
+
+    Generator(uint64_t seed, std::ostream& out) : rng{seed}, out{out} {}
+
+    void Generate(size_t day, size_t scale) {
+        (this->*days[day - 1])(scale);
+    }
+};
+
+int main(int argc, const char* argv[]) {
+    if (argc < 3 || argc > 4) {
+        std::cerr << "Usage: " << argv[0] << " <day> <scale> [seed]\n";
+        return 1;
+    }
+    const auto day = ToInt<size_t>(argv[1]);
+    const auto scale = ToInt<size_t>(argv[2]);
+    const auto seed = argc > 3 ? ToInt<uint64_t>(argv[3]) : 2020;
+    if (!day || *day < 1 || *day > Generator::days.size() || !scale || !seed) {
+        std::cerr << "The day must be 1-" << Generator::days.size() << ", and the scale and seed integers.\n";
+        return 1;
+    }
+    std::ios_base::sync_with_stdio(false);
+    try {
+        Generator{*seed, std::cout}.Generate(*day, *scale);
+    } catch (const std::invalid_argument& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
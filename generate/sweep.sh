@@ -0,0 +1,36 @@
+#!/bin/sh
+# Times one day's solver on generated inputs of each given scale and prints CSV, ready for plotting a scaling curve.
+#
+#   generate/sweep.sh <build dir> <day> <scale>...
+#
+# SEED picks the generator seed (default 2020) and RUNS the number of timed runs per scale (default 3), each of which
+# gets its own row. Inputs are written to a temporary directory which is removed afterwards.
+set -eu
+
+if [ $# -lt 3 ]; then
+    echo "Usage: $0 <build dir> <day> <scale>..." >&2
+    exit 1
+fi
+build=$1
+day=$2
+shift 2
+seed=${SEED:-2020}
+runs=${RUNS:-3}
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+echo "day,scale,seed,bytes,run,seconds"
+for scale in "$@"; do
+    input="$dir/day$day-$scale"
+    "$build/generate" "$day" "$scale" "$seed" > "$input"
+    bytes=$(wc -c < "$input" | tr -d ' ')
+    run=1
+    while [ "$run" -le "$runs" ]; do
+        start=$(date +%s%N)
+        "$build/day$day" "$input" > /dev/null
+        end=$(date +%s%N)
+        echo "$day,$scale,$seed,$bytes,$run,$(awk "BEGIN { printf \"%.6f\", ($end - $start) / 1e9 }")"
+        run=$((run + 1))
+    done
+done
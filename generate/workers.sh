@@ -0,0 +1,37 @@
+#!/bin/sh
+# Times a pipelined day (2, 5 or 6) on one generated input with each given number of workers and prints CSV, ready
+# for plotting the speedup against core count.
+#
+#   generate/workers.sh <build dir> <day> <scale> <workers>...
+#
+# SEED and RUNS work as for sweep.sh. AOC_PIPELINE_BATCH and AOC_PIPELINE_QUEUE are passed through, so the batch
+# size and queue depth can be varied between sweeps.
+set -eu
+
+if [ $# -lt 4 ]; then
+    echo "Usage: $0 <build dir> <day> <scale> <workers>..." >&2
+    exit 1
+fi
+build=$1
+day=$2
+scale=$3
+shift 3
+seed=${SEED:-2020}
+runs=${RUNS:-3}
+
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+input="$dir/day$day-$scale"
+"$build/generate" "$day" "$scale" "$seed" > "$input"
+
+echo "day,scale,seed,workers,run,seconds"
+for workers in "$@"; do
+    run=1
+    while [ "$run" -le "$runs" ]; do
+        start=$(date +%s%N)
+        AOC_PIPELINE_WORKERS=$workers "$build/day$day" "$input" > /dev/null
+        end=$(date +%s%N)
+        echo "$day,$scale,$seed,$workers,$run,$(awk "BEGIN { printf \"%.6f\", ($end - $start) / 1e9 }")"
+        run=$((run + 1))
+    done
+done
@@ -0,0 +1,142 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "common/parse.h"
+#include "common/serve.h"
+
+// Drives a day running in --serve mode and reports how long its answers take. Each connection is closed-loop: it
+// sends one query, waits for the answer and only then sends the next, cycling through the queries it was given, so
+// the latencies are those of a single request rather than of a queue.
+class LoadGenerator {
+    using Clock = std::chrono::steady_clock;
+
+    std::string socketPath;
+    std::vector<std::string> queries;
+
+    struct Result {
+        std::vector<Clock::duration> latencies;
+        size_t errors = 0;
+    };
+
+    [[nodiscard]] int Connect() const {
+#if AOC_HAVE_UNIX_SOCKETS
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path))
+            throw std::invalid_argument{"Socket path is too long: " + socketPath};
+        std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+        const auto fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1 || connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+            throw std::runtime_error{"Unable to connect to " + socketPath + ": " + std::strerror(errno)};
+        return fd;
+#else
+        throw std::runtime_error{"The load generator needs UNIX domain sockets."};
+#endif
+    }
+
+    void Drive([[maybe_unused]] size_t connection, [[maybe_unused]] size_t requests, Result& result) const {
+#if AOC_HAVE_UNIX_SOCKETS
+        const auto fd = Connect();
+        std::string reply;
+        char buffer[4096];
+        result.latencies.reserve(requests);
+        for (size_t i = 0; i < requests; ++i) {
+            const auto& query = queries[(connection + i) % queries.size()];
+            const auto start = Clock::now();
+            if (send(fd, query.data(), query.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(query.size()))
+                throw std::runtime_error{"The server hung up."};
+            size_t end;
+            while ((end = reply.find('\n')) == std::string::npos) {
+                const auto got = recv(fd, buffer, sizeof(buffer), 0);
+                if (got <= 0)
+                    throw std::runtime_error{"The server hung up."};
+                reply.append(buffer, got);
+            }
+            result.latencies.push_back(Clock::now() - start);
+            if (reply.starts_with("error:"))
+                ++result.errors;
+            reply.erase(0, end + 1);
+        }
+        close(fd);
+#endif
+    }
+
+    [[nodiscard]] static double Micros(Clock::duration duration) noexcept {
+        return std::chrono::duration<double, std::micro>{duration}.count();
+    }
+public:
+    LoadGenerator(std::string socketPath, std::vector<std::string> lines) : socketPath{std::move(socketPath)},
+                                                                             queries{std::move(lines)} {
+        for (auto& query : queries)
+            query.push_back('\n');
+    }
+
+    void Run(size_t connections, size_t requests, std::ostream& out) const {
+        std::vector<Result> results(connections);
+        const auto start = Clock::now();
+        {
+            std::vector<std::jthread> threads;
+            for (size_t i = 0; i < connections; ++i) {
+                threads.emplace_back([this, i, requests, &result = results[i]] {
+                    try {
+                        Drive(i, requests, result);
+                    } catch (const std::exception& e) {
+                        std::cerr << e.what() << '\n';
+                    }
+                });
+            }
+        }
+        const auto elapsed = Clock::now() - start;
+
+        std::vector<Clock::duration> latencies;
+        size_t errors = 0;
+        for (auto& result : results) {
+            latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+            errors += result.errors;
+        }
+        if (latencies.empty())
+            throw std::runtime_error{"No requests were answered."};
+        std::ranges::sort(latencies);
+        const auto percentile = [&latencies] (size_t p) {
+            return Micros(latencies[std::min(latencies.size() - 1, latencies.size() * p / 100)]);
+        };
+        const auto seconds = std::chrono::duration<double>{elapsed}.count();
+        out << "requests: " << latencies.size() << " (" << errors << " errors)\n"
+            << "seconds: " << seconds << '\n'
+            << "requests/s: " << latencies.size() / seconds << '\n'
+            << "p50 us: " << percentile(50) << '\n'
+            << "p90 us: " << percentile(90) << '\n'
+            << "p99 us: " << percentile(99) << '\n'
+            << "max us: " << Micros(latencies.back()) << '\n';
+    }
+};
+
+int main(int argc, const char* argv[]) {
+    if (argc < 5) {
+        std::cerr << "Usage: " << argv[0] << " <socket> <connections> <requests per connection> <query>...\n";
+        return 1;
+    }
+    const auto connections = ToInt<size_t>(argv[2]);
+    const auto requests = ToInt<size_t>(argv[3]);
+    if (!connections || !requests || *connections == 0 || *requests == 0) {
+        std::cerr << "The connection and request counts must be positive integers.\n";
+        return 1;
+    }
+    try {
+        LoadGenerator{argv[1], {argv + 4, argv + argc}}.Run(*connections, *requests, std::cout);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}